@@ -1,8 +1,24 @@
 #include <iostream>
 #include <vector>
 #include <queue>
+#include <deque>
+#include <set>
 #include <algorithm>
 #include <climits>
+#include <cmath>
+#include <tuple>
+#include <memory>
+#include <iomanip>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
 using namespace std;
 
 struct Process {
@@ -14,6 +30,16 @@ struct Process {
     int completion;
     int turnaround;
     int waiting;
+    int level;       // MLFQ: queue level, time used at it, when it got there
+    int used;
+    int leveledAt;
+    int queuedAt;    // MLFQ: when it last entered a queue (aging)
+    int readyAt;     // FCFS: when it arrived or its last I/O finished
+    long long vruntime;  // CFS: weighted run time, -1 until first queued
+    int lastCore;    // SMP: core it last ran on, -1 before its first run
+    vector<int> bursts;  // CPU, I/O, CPU, ... for a process that does I/O (burst is the CPU total)
+    int io = 0;      // total I/O time
+    int phase;       // index in bursts of the current CPU burst
 };
 
 // Print table of results
@@ -26,165 +52,1309 @@ void printTable(const vector<Process>& procs) {
     }
 }
 
-// 1) FCFS - First Come First Serve (non-preemptive)
-void FCFS(vector<Process> procs) {
-    cout << "\n--- FCFS ---\n";
-    sort(procs.begin(), procs.end(), [](const Process &a, const Process &b){
-        return a.arrival < b.arrival;
-    });
+// --- Discrete-event engine ---
+// Time jumps from event to event (an arrival, an I/O completion, the end of
+// a CPU burst or of a quantum) instead of ticking, so idle gaps and long
+// bursts cost nothing.
 
-    int currentTime = 0;
-    for (auto &p : procs) {
-        if (currentTime < p.arrival) currentTime = p.arrival;
-        p.completion = currentTime + p.burst;
-        p.turnaround = p.completion - p.arrival;
-        p.waiting = p.turnaround - p.burst;
-        currentTime = p.completion;
-    }
-    printTable(procs);
+void initRunState(Process &p) {
+    p.phase = 0;
+    p.remaining = p.bursts.empty() ? p.burst : p.bursts[0];
+    p.level = p.used = p.leveledAt = p.queuedAt = 0;
+    p.vruntime = -1;
+    p.lastCore = -1;
+    p.readyAt = p.arrival;
 }
 
-// 2) Preemptive SJF (Shortest Remaining Time First)
-void SJF_Preemptive(vector<Process> procs) {
-    cout << "\n--- SJF (Preemptive) ---\n";
-    int n = procs.size();
-    for (auto &p : procs) p.remaining = p.burst;
+void resetRunState(vector<Process> &procs) {
+    for (auto &p : procs) initRunState(p);
+}
 
-    int completed = 0;
-    int time = 0;
+// Where the engines get processes from and where finished ones go
+struct Workload {
+    virtual ~Workload() {}
+    // arrival time of the next process not yet admitted (INT_MAX: none left)
+    virtual int nextArrival() const = 0;
+    // append the indices of the processes that have arrived by time, in pid order
+    virtual void admit(int time, vector<Process> &procs, vector<int> &admitted) = 0;
+    // process i completed; its completion, turnaround and waiting are set
+    virtual void finish(vector<Process> &, int) {}
+};
 
-    while (completed < n) {
-        // find process with smallest remaining time that has arrived
-        int idx = -1;
-        int bestRem = INT_MAX;
-        for (int i = 0; i < n; ++i) {
-            if (procs[i].arrival <= time && procs[i].remaining > 0) {
-                if (procs[i].remaining < bestRem) {
-                    bestRem = procs[i].remaining;
-                    idx = i;
-                }
+// All processes are in procs up front
+struct TableWorkload : Workload {
+    vector<int> arrivals;   // earliest first
+    size_t next = 0;
+    int nextTime = INT_MAX;
+    TableWorkload(vector<Process> &procs) : arrivals(procs.size()) {
+        resetRunState(procs);
+        for (size_t i = 0; i < procs.size(); ++i) arrivals[i] = i;
+        stable_sort(arrivals.begin(), arrivals.end(), [&](int a, int b){ return procs[a].arrival < procs[b].arrival; });
+        if (!arrivals.empty()) nextTime = procs[arrivals[0]].arrival;
+    }
+    int nextArrival() const override { return nextTime; }
+    void admit(int time, vector<Process> &procs, vector<int> &admitted) override {
+        size_t from = next;
+        while (next < arrivals.size() && procs[arrivals[next]].arrival <= time) next++;
+        sort(arrivals.begin() + from, arrivals.begin() + next);
+        admitted.insert(admitted.end(), arrivals.begin() + from, arrivals.begin() + next);
+        nextTime = next < arrivals.size() ? procs[arrivals[next]].arrival : INT_MAX;
+    }
+};
+
+// Which arrived process gets the CPU next
+struct ReadyQueue {
+    virtual ~ReadyQueue() {}
+    virtual void push(int i) = 0;
+    virtual int pop() = 0;
+    virtual int top() const = 0;
+    virtual bool empty() const = 0;
+    // true if a would be picked ahead of b (never, for arrival order)
+    virtual bool before(int, int) const { return false; }
+    // process i is about to be pushed back after waiting for I/O
+    virtual void woke(int) {}
+    // time slice for process i once popped (0: the engine's quantum)
+    virtual int slice(int) { return 0; }
+    // process i ran for `ran` time units
+    virtual void charge(int, int) {}
+    // the clock moved to time
+    virtual void setTime(int) {}
+};
+
+// First in, first out (Round Robin)
+struct FifoQueue : ReadyQueue {
+    queue<int> q;
+    void push(int i) override { q.push(i); }
+    int pop() override { int i = q.front(); q.pop(); return i; }
+    int top() const override { return q.front(); }
+    bool empty() const override { return q.empty(); }
+};
+
+// Smallest key field first, ties to the lower pid (FCFS, SRTF, Priority).
+// Indexed binary min-heap: pos[i] is process i's heap slot (-1 when not
+// queued), so push, pop, update and remove are O(log n). A process sits in
+// one queue at a time, so the queues of several cores can share pos.
+struct MinKeyQueue : ReadyQueue {
+    const vector<Process> &procs;
+    int Process::*key;
+    vector<int> heap;
+    vector<int> ownPos;
+    vector<int> &pos;     // grown on push
+    MinKeyQueue(const vector<Process> &procs, int Process::*key, vector<int> *sharedPos = nullptr)
+        : procs(procs), key(key), pos(sharedPos ? *sharedPos : ownPos) {}
+
+    bool less(int a, int b) const {
+        const Process &x = procs[a], &y = procs[b];
+        return x.*key < y.*key || (x.*key == y.*key && x.pid < y.pid);
+    }
+    void place(int slot, int i) { heap[slot] = i; pos[i] = slot; }
+    void siftUp(int slot) {
+        int i = heap[slot];
+        while (slot > 0 && less(i, heap[(slot - 1) / 2])) { place(slot, heap[(slot - 1) / 2]); slot = (slot - 1) / 2; }
+        place(slot, i);
+    }
+    void siftDown(int slot) {
+        int i = heap[slot], n = heap.size();
+        while (true) {
+            int c = 2 * slot + 1;
+            if (c >= n) break;
+            if (c + 1 < n && less(heap[c + 1], heap[c])) c++;
+            if (!less(heap[c], i)) break;
+            place(slot, heap[c]);
+            slot = c;
+        }
+        place(slot, i);
+    }
+
+    void push(int i) override {
+        if (i >= (int)pos.size()) pos.resize(procs.size(), -1);
+        heap.push_back(i);
+        siftUp(heap.size() - 1);
+    }
+    int pop() override { int i = heap[0]; remove(i); return i; }
+    int top() const override { return heap[0]; }
+    bool before(int a, int b) const override { return less(a, b); }
+    bool empty() const override { return heap.empty(); }
+    // restore order after process i's key changed while queued
+    void update(int i) { siftUp(pos[i]); siftDown(pos[i]); }
+    void remove(int i) {
+        int slot = pos[i], last = heap.back();
+        heap.pop_back();
+        pos[i] = -1;
+        if (last == i) return;
+        place(slot, last);
+        update(last);
+    }
+};
+
+// Multilevel feedback queue: FIFO levels, level 0 first. Level L has an
+// allotment of quantum << L; a process that uses it up moves down a level.
+// A process waiting longer than `aging` at one level moves up one, and every
+// `boost` time units all processes go back to level 0 (0 turns either off).
+struct MLFQConfig {
+    int levels = 3, quantum = 2, boost = 0, aging = 0;
+    // largest base quantum whose bottom allotment, quantum << (levels - 1), fits an int
+    static int maxQuantum(int levels) { return INT_MAX >> (levels - 1); }
+    bool valid() const {
+        return levels >= 1 && levels <= 16 && quantum > 0 && quantum <= maxQuantum(levels) && boost >= 0 && aging >= 0;
+    }
+};
+
+struct MLFQQueue : ReadyQueue {
+    vector<Process> &procs;
+    MLFQConfig cfg;
+    vector<deque<int>> levels;
+    int size = 0;
+    int now = 0, lastBoost = 0;
+    MLFQQueue(vector<Process> &procs, const MLFQConfig &cfg) : procs(procs), cfg(cfg), levels(cfg.levels) {}
+
+    int allotment(int level) const { return cfg.quantum << level; }
+    void setLevel(Process &p, int level) { p.level = level; p.used = 0; p.leveledAt = now; }
+    void enter(int i) { procs[i].queuedAt = now; levels[procs[i].level].push_back(i); }
+    // a process that was running during a boost missed it
+    void catchUp(Process &p) { if (cfg.boost > 0 && p.leveledAt < lastBoost) setLevel(p, 0); }
+
+    void push(int i) override { catchUp(procs[i]); enter(i); size++; }
+    int top() const override {
+        for (const auto &q : levels) if (!q.empty()) return q.front();
+        return -1;
+    }
+    int pop() override {
+        for (auto &q : levels)
+            if (!q.empty()) { int i = q.front(); q.pop_front(); size--; return i; }
+        return -1;
+    }
+    bool empty() const override { return size == 0; }
+    bool before(int a, int b) const override { return procs[a].level < procs[b].level; }
+    int slice(int i) override { return allotment(procs[i].level) - procs[i].used; }
+    void charge(int i, int ran) override {
+        Process &p = procs[i];
+        catchUp(p);
+        p.used += ran;
+        if (p.used >= allotment(p.level)) setLevel(p, min(p.level + 1, cfg.levels - 1));
+    }
+    void setTime(int time) override {
+        now = time;
+        if (cfg.boost > 0 && now - lastBoost >= cfg.boost) {
+            lastBoost = now - (now - lastBoost) % cfg.boost;
+            for (int l = 1; l < cfg.levels; ++l) {
+                for (int i : levels[l]) { setLevel(procs[i], 0); procs[i].queuedAt = now; levels[0].push_back(i); }
+                levels[l].clear();
             }
         }
+        if (cfg.aging > 0) {
+            // each level is in queuing order, so only fronts can be due
+            for (int l = 1; l < cfg.levels; ++l)
+                while (!levels[l].empty() && now - procs[levels[l].front()].queuedAt >= cfg.aging) {
+                    int i = levels[l].front();
+                    levels[l].pop_front();
+                    setLevel(procs[i], l - 1);
+                    enter(i);
+                }
+        }
+    }
+};
+
+// CFS-like fair share: runnable processes sit in a red-black tree (std::set)
+// by virtual runtime, which grows by run time scaled by 1024 / weight. The
+// weight comes from `priority` read as a nice value (-20..19, lower is more
+// important). The leftmost process runs for its weighted share of `latency`,
+// at least `minGranularity`; an arrival preempts when its virtual runtime is
+// more than `wakeupGranularity` behind. New processes start at the queue's
+// minimum virtual runtime, so they cannot starve the ones already there.
+struct CFSConfig { int latency = 24, minGranularity = 3, wakeupGranularity = 4; };
+
+const int NICE_TO_WEIGHT[40] = {
+    88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+    9548, 7620, 6100, 4904, 3906, 3121, 2501, 1991, 1586, 1277,
+    1024, 820, 655, 526, 423, 335, 272, 215, 172, 137,
+    110, 87, 70, 56, 45, 36, 29, 23, 18, 15,
+};
+
+struct CFSQueue : ReadyQueue {
+    vector<Process> &procs;
+    CFSConfig cfg;
+    set<tuple<long long, int, int>> tree;   // (vruntime, pid, index)
+    long long minVruntime = 0, queuedWeight = 0;
+    CFSQueue(vector<Process> &procs, const CFSConfig &cfg) : procs(procs), cfg(cfg) {}
+
+    int weight(int i) const { return NICE_TO_WEIGHT[min(max(procs[i].priority, -20), 19) + 20]; }
+
+    void push(int i) override {
+        if (procs[i].vruntime < 0) procs[i].vruntime = minVruntime;
+        tree.insert(make_tuple(procs[i].vruntime, procs[i].pid, i));
+        queuedWeight += weight(i);
+    }
+    int top() const override { return get<2>(*tree.begin()); }
+    int pop() override {
+        int i = get<2>(*tree.begin());
+        tree.erase(tree.begin());
+        queuedWeight -= weight(i);
+        minVruntime = max(minVruntime, procs[i].vruntime);
+        return i;
+    }
+    bool empty() const override { return tree.empty(); }
+    bool before(int a, int b) const override {
+        return procs[a].vruntime + 1024LL * cfg.wakeupGranularity < procs[b].vruntime;
+    }
+    // a sleeper may not come back more than half a latency ahead
+    void woke(int i) override {
+        procs[i].vruntime = max(procs[i].vruntime, minVruntime - 1024LL * cfg.latency / 2);
+    }
+    int slice(int i) override {
+        long long w = weight(i);
+        return (int)max<long long>(cfg.minGranularity, cfg.latency * w / (queuedWeight + w));
+    }
+    void charge(int i, int ran) override {
+        procs[i].vruntime += (long long)ran * 1024 * 1024 / weight(i);
+        // like the kernel's min_vruntime: the running process counts too
+        long long least = tree.empty() ? procs[i].vruntime : min(procs[i].vruntime, get<0>(*tree.begin()));
+        minVruntime = max(minVruntime, least);
+    }
+};
+
+// Binary schedule timeline: an 8-byte header ("GANT", int32 core count)
+// then one 16-byte record per piece of a dispatch: int32 start, end, pid,
+// int16 core, uint8 kind (a GanttKind), uint8 0. Idle time has no records.
+enum GanttKind { G_RUN, G_SWITCH, G_MIGRATION, G_WARMUP };
+const int MAX_CORES = 32767;    // core numbers must fit the int16 field
+
+struct GanttWriter {
+    FILE *f = nullptr;
+    long long records = 0;
+    bool failed = false;    // a write went wrong
+
+    ~GanttWriter() { if (f) fclose(f); }
+    bool open(const string &path, int cores) {
+        f = fopen(path.c_str(), "wb");
+        if (!f) return false;
+        setvbuf(f, nullptr, _IOFBF, 1 << 20);
+        int32_t n = cores;
+        failed = fwrite("GANT", 1, 4, f) != 4 || fwrite(&n, 4, 1, f) != 1;
+        return true;
+    }
+    // Flush and close; false if any write failed
+    bool close() {
+        bool ok = !failed && fclose(f) == 0;
+        if (failed) fclose(f);
+        f = nullptr;
+        return ok;
+    }
+    void piece(int core, int pid, int start, int end, GanttKind kind) {
+        if (end <= start) return;
+        char rec[16] = {};
+        int32_t v[3] = {start, end, pid};
+        int16_t c = core;
+        memcpy(rec, v, 12);
+        memcpy(rec + 12, &c, 2);
+        rec[14] = (char)kind;
+        if (fwrite(rec, 1, 16, f) != 16) failed = true;
+        records++;
+    }
+    // a dispatch that lasted from start to stop: its overheads, then the run
+    void dispatch(int core, int pid, int start, int stop, int contextSwitch, int migration, int warmup) {
+        int t = start;
+        const pair<int, GanttKind> pieces[] = {{contextSwitch, G_SWITCH}, {migration, G_MIGRATION}, {warmup, G_WARMUP}};
+        for (const auto &pc : pieces) {
+            piece(core, pid, t, min(stop, t + pc.first), pc.second);
+            t = min(stop, t + pc.first);
+        }
+        piece(core, pid, t, stop, G_RUN);
+    }
+};
 
-        if (idx == -1) {
-            // no job available now
-            time++;
-            continue;
+// Dispatch overheads. A context switch is paid whenever a CPU picks up a
+// process other than the one it just stopped at that instant (so also on
+// wake-up from idle); cache warm-up is paid when another process ran on the
+// CPU since this one last did. Neither counts against the slice.
+struct RunOptions {
+    int contextSwitch = 0;
+    int warmup = 0;
+    GanttWriter *gantt = nullptr;
+};
+
+struct CoreStats {
+    long long busy = 0;     // time running processes or paying overheads
+    long long overhead = 0; // switch, migration and warm-up time
+    int dispatches = 0;
+    int switches = 0;       // dispatches that paid a context switch
+    int migrations = 0;     // processes migrated onto this core
+};
+
+// Processes waiting for I/O, earliest wake-up first (ties to the lower pid)
+struct BlockedQueue {
+    priority_queue<tuple<int, int, int>, vector<tuple<int, int, int>>, greater<tuple<int, int, int>>> q;
+
+    int nextWake() const { return q.empty() ? INT_MAX : get<0>(q.top()); }
+    // process i ended a CPU burst at time: true if I/O follows, and it now waits
+    bool block(vector<Process> &procs, int i, int time) {
+        Process &p = procs[i];
+        if (p.phase + 1 >= (int)p.bursts.size()) return false;
+        q.push(make_tuple(time + p.bursts[p.phase + 1], p.pid, i));
+        p.readyAt = time + p.bursts[p.phase + 1];
+        p.phase += 2;
+        p.remaining = p.bursts[p.phase];
+        return true;
+    }
+    // append the processes whose I/O is done by time
+    void wake(int time, vector<int> &woken) {
+        while (!q.empty() && get<0>(q.top()) <= time) { woken.push_back(get<2>(q.top())); q.pop(); }
+    }
+};
+
+void complete(Workload &work, vector<Process> &procs, int i, int time) {
+    Process &p = procs[i];
+    p.completion = time;
+    p.turnaround = p.completion - p.arrival;
+    p.waiting = p.turnaround - p.burst - p.io;
+    work.finish(procs, i);
+}
+
+// Run the workload to completion. Processes that arrive together enter the
+// ready queue in pid order, followed by those done with I/O. The running
+// process keeps the CPU until its CPU burst ends (then it waits for the I/O
+// that follows or is done) or its slice ends (quantum, or the queue's slice
+// when quantum is 0), then queues again behind any new arrivals. With
+// preemptOnArrival, an arrival also takes the CPU if the queue would pick it
+// ahead of the running process.
+CoreStats simulate(Workload &work, vector<Process> &procs, ReadyQueue &ready, int quantum, bool preemptOnArrival,
+                   const RunOptions &opt = RunOptions()) {
+    CoreStats stats;
+    BlockedQueue blocked;
+    int time = 0;
+    vector<int> admitted, woken;
+    auto nextEntry = [&]() { return min(work.nextArrival(), blocked.nextWake()); };
+    auto admit = [&]() {
+        ready.setTime(time);
+        admitted.clear();
+        work.admit(time, procs, admitted);
+        for (int i : admitted) ready.push(i);
+        woken.clear();
+        blocked.wake(time, woken);
+        for (int i : woken) { ready.woke(i); ready.push(i); }
+    };
+
+    int idx = -1, sliceEnd = 0;
+    int dispatchAt = 0, workFrom = 0, switchCost = 0, warmupCost = 0;
+    int lastRan = -1, stoppedAt = -1;
+    auto stop = [&]() {
+        stats.busy += time - dispatchAt;
+        stats.overhead += min(time, workFrom) - dispatchAt;
+        if (opt.gantt) opt.gantt->dispatch(0, procs[idx].pid, dispatchAt, time, switchCost, 0, warmupCost);
+        lastRan = idx;
+        stoppedAt = time;
+        idx = -1;
+    };
+    while (true) {
+        if (idx < 0) {
+            admit();
+            if (ready.empty()) {
+                // CPU idle: jump to the next arrival or wake-up
+                if (nextEntry() == INT_MAX) break;
+                time = nextEntry();
+                continue;
+            }
+            idx = ready.pop();
+            bool switched = !(idx == lastRan && stoppedAt == time);
+            switchCost = switched ? opt.contextSwitch : 0;
+            warmupCost = idx != lastRan ? opt.warmup : 0;
+            stats.dispatches++;
+            stats.switches += switched;
+            dispatchAt = time;
+            workFrom = time + switchCost + warmupCost;
+            int s = quantum > 0 ? quantum : ready.slice(idx);
+            sliceEnd = s > 0 && workFrom <= INT_MAX - s ? workFrom + s : INT_MAX;
         }
 
-        // execute 1 unit of time
-        procs[idx].remaining--;
-        time++;
+        Process &p = procs[idx];
+        int from = max(time, workFrom);
+        int end = min(from + p.remaining, sliceEnd);
+        if (preemptOnArrival) end = min(end, nextEntry());
+        int ran = max(0, end - from);
+        p.remaining -= ran;
+        time = end;
+        ready.setTime(time);
+        if (ran > 0) ready.charge(idx, ran);
 
-        // if finished, record times
-        if (procs[idx].remaining == 0) {
-            completed++;
-            procs[idx].completion = time;
-            procs[idx].turnaround = procs[idx].completion - procs[idx].arrival;
-            procs[idx].waiting = procs[idx].turnaround - procs[idx].burst;
+        if (p.remaining == 0) {
+            int i = idx;
+            stop();
+            if (!blocked.block(procs, i, time)) complete(work, procs, i, time);
+        } else if (time == sliceEnd) {
+            admit();
+            ready.push(idx);
+            stop();
+        } else {
+            // an arrival: keep running unless it goes first
+            admit();
+            if (!ready.empty() && ready.before(ready.top(), idx)) { ready.push(idx); stop(); }
         }
     }
+    return stats;
+}
+
+CoreStats simulate(vector<Process> &procs, ReadyQueue &ready, int quantum, bool preemptOnArrival,
+                   const RunOptions &opt = RunOptions()) {
+    TableWorkload work(procs);
+    return simulate(work, procs, ready, quantum, preemptOnArrival, opt);
+}
+
+// Dispatch overheads of a run, when there were any to pay
+void printOverheads(const CoreStats &stats, const RunOptions &opt) {
+    if (opt.contextSwitch || opt.warmup)
+        cout << "Context switches: " << stats.switches << "  Overhead: " << stats.overhead << '\n';
+}
 
+// 1) FCFS - First Come First Serve (non-preemptive)
+void FCFS(vector<Process> procs, const RunOptions &opt) {
+    cout << "\n--- FCFS ---\n";
+    stable_sort(procs.begin(), procs.end(), [](const Process &a, const Process &b){
+        return a.arrival < b.arrival;
+    });
+
+    MinKeyQueue ready(procs, &Process::readyAt);
+    CoreStats stats = simulate(procs, ready, 0, false, opt);
+    printTable(procs);
+    printOverheads(stats, opt);
+}
+
+// 2) Preemptive SJF (Shortest Remaining Time First)
+void SJF_Preemptive(vector<Process> procs, const RunOptions &opt) {
+    cout << "\n--- SJF (Preemptive) ---\n";
+    MinKeyQueue ready(procs, &Process::remaining);
+    CoreStats stats = simulate(procs, ready, 0, true, opt);
     printTable(procs);
+    printOverheads(stats, opt);
 }
 
 // 3) Priority Scheduling (Non-preemptive)
-void Priority_NonPreemptive(vector<Process> procs) {
+void Priority_NonPreemptive(vector<Process> procs, const RunOptions &opt) {
     cout << "\n--- Priority (Non-preemptive) ---\n";
-    int n = procs.size();
-    vector<bool> done(n, false);
-    int finished = 0;
+    MinKeyQueue ready(procs, &Process::priority);
+    CoreStats stats = simulate(procs, ready, 0, false, opt);
+    printTable(procs);
+    printOverheads(stats, opt);
+}
+
+// 4) Round Robin (Preemptive)
+void RoundRobin(vector<Process> procs, int quantum, const RunOptions &opt) {
+    cout << "\n--- Round Robin (q = " << quantum << ") ---\n";
+    FifoQueue ready;
+    CoreStats stats = simulate(procs, ready, quantum, false, opt);
+    printTable(procs);
+    printOverheads(stats, opt);
+}
+
+// 5) Multilevel feedback queue (preemptive)
+void MLFQ(vector<Process> procs, const MLFQConfig &cfg, const RunOptions &opt) {
+    cout << "\n--- MLFQ (" << cfg.levels << " levels, q = " << cfg.quantum << ", boost " << cfg.boost
+         << ", aging " << cfg.aging << ") ---\n";
+    MLFQQueue ready(procs, cfg);
+    CoreStats stats = simulate(procs, ready, 0, true, opt);
+    printTable(procs);
+    printOverheads(stats, opt);
+}
+
+// 6) CFS-like fair scheduling (preemptive)
+void CFS(vector<Process> procs, const CFSConfig &cfg, const RunOptions &opt) {
+    cout << "\n--- CFS (latency " << cfg.latency << ", min granularity " << cfg.minGranularity
+         << ", wakeup granularity " << cfg.wakeupGranularity << ") ---\n";
+    CFSQueue ready(procs, cfg);
+    CoreStats stats = simulate(procs, ready, 0, true, opt);
+    printTable(procs);
+    printOverheads(stats, opt);
+}
+
+// --- Multi-core (SMP) simulation ---
+// Each core runs one process at a time. With BAL_GLOBAL all cores share one
+// ready queue; otherwise every core has its own, arrivals go to the least
+// loaded core (queued + running, ties to the lower core) and with BAL_STEAL
+// a core that runs dry takes the head of the longest other queue. A process
+// starting on a different core than it last ran on is a migration and costs
+// migrationCost time units on the new core before it makes progress.
+enum Balance { BAL_GLOBAL, BAL_PERCORE, BAL_STEAL };
+
+enum QueueKind { Q_KEY, Q_FIFO, Q_MLFQ, Q_CFS };
+
+struct Policy {
+    const char *name;
+    QueueKind kind;
+    int Process::*key;      // Q_KEY: ordering field
+    int quantum;            // 0: the queue's slice, or run until done or preempted
+    bool preemptOnArrival;
+    MLFQConfig mlfq;
+    CFSConfig cfs;
+};
+
+// sharedPos: heap slots shared by the keyed queues of one simulation
+unique_ptr<ReadyQueue> makeQueue(vector<Process> &procs, const Policy &pol, vector<int> *sharedPos = nullptr) {
+    switch (pol.kind) {
+    case Q_KEY: return unique_ptr<ReadyQueue>(new MinKeyQueue(procs, pol.key, sharedPos));
+    case Q_MLFQ: return unique_ptr<ReadyQueue>(new MLFQQueue(procs, pol.mlfq));
+    case Q_CFS: return unique_ptr<ReadyQueue>(new CFSQueue(procs, pol.cfs));
+    default: return unique_ptr<ReadyQueue>(new FifoQueue());
+    }
+}
+
+// Policy by menu number: 1 FCFS, 2 SJF, 3 Priority, 4 RR, 5 MLFQ, 6 CFS
+Policy makePolicy(int choice, int quantum, const MLFQConfig &mlfq, const CFSConfig &cfs) {
+    const Policy policies[] = {
+        {"FCFS", Q_KEY, &Process::readyAt, 0, false, mlfq, cfs},
+        {"SJF (Preemptive)", Q_KEY, &Process::remaining, 0, true, mlfq, cfs},
+        {"Priority (Non-preemptive)", Q_KEY, &Process::priority, 0, false, mlfq, cfs},
+        {"Round Robin", Q_FIFO, nullptr, quantum, false, mlfq, cfs},
+        {"MLFQ", Q_MLFQ, nullptr, 0, true, mlfq, cfs},
+        {"CFS", Q_CFS, nullptr, 0, true, mlfq, cfs},
+    };
+    return policies[choice - 1];
+}
+
+// Same event order as simulate(): arrivals are queued before processes whose
+// slice ends at the same time, so one core reproduces its results.
+vector<CoreStats> simulateSMP(Workload &work, vector<Process> &procs, const Policy &pol, int ncores, Balance bal, int migrationCost,
+                              const RunOptions &opt = RunOptions()) {
+    vector<unique_ptr<ReadyQueue>> queues;
+    vector<int> heapPos;
+    for (int q = 0; q < (bal == BAL_GLOBAL ? 1 : ncores); ++q) queues.push_back(makeQueue(procs, pol, &heapPos));
+    vector<int> queued(queues.size(), 0);
+    auto queueOf = [&](int c) { return bal == BAL_GLOBAL ? 0 : c; };
+    auto enqueue = [&](int q, int i) { queues[q]->push(i); queued[q]++; };
+    auto dequeue = [&](int q) { queued[q]--; return queues[q]->pop(); };
+
+    struct Core {
+        int running = -1;
+        int start, workFrom, end, version = 0;
+        int switchCost, migration, warmup;  // paid by the current dispatch
+        int lastRan = -1, stoppedAt = -1;
+    };
+    vector<Core> cores(ncores);
+    vector<CoreStats> stats(ncores);
+    BlockedQueue blocked;
+    int busy = 0;           // cores running a process
+    // slice ends as (time, core, version); stale entries are skipped
+    priority_queue<tuple<int, int, int>, vector<tuple<int, int, int>>, greater<tuple<int, int, int>>> events;
+
+    auto start = [&](int c, int i, int time) {
+        Core &core = cores[c];
+        bool switched = !(i == core.lastRan && core.stoppedAt == time);
+        core.switchCost = switched ? opt.contextSwitch : 0;
+        core.migration = 0;
+        if (procs[i].lastCore >= 0 && procs[i].lastCore != c) { stats[c].migrations++; core.migration = migrationCost; }
+        core.warmup = i != core.lastRan ? opt.warmup : 0;
+        procs[i].lastCore = c;
+        stats[c].dispatches++;
+        stats[c].switches += switched;
+        int run = procs[i].remaining;
+        int s = pol.quantum > 0 ? pol.quantum : queues[queueOf(c)]->slice(i);
+        if (s > 0) run = min(run, s);
+        busy++;
+        core.running = i;
+        core.start = time;
+        core.workFrom = time + core.switchCost + core.migration + core.warmup;
+        core.end = core.workFrom + run;
+        events.push(make_tuple(core.end, c, ++core.version));
+    };
+    // bring the running process's remaining time up to date
+    auto sync = [&](int c, int time) {
+        Core &core = cores[c];
+        if (time <= core.workFrom) return;
+        procs[core.running].remaining -= time - core.workFrom;
+        queues[queueOf(c)]->charge(core.running, time - core.workFrom);
+        core.workFrom = time;
+    };
+    // stop core c at time; returns the process it ran
+    auto stop = [&](int c, int time) {
+        Core &core = cores[c];
+        int i = core.running;
+        if (time > core.workFrom) {
+            procs[i].remaining -= time - core.workFrom;
+            queues[queueOf(c)]->charge(i, time - core.workFrom);
+        }
+        stats[c].busy += time - core.start;
+        stats[c].overhead += min(time, core.start + core.switchCost + core.migration + core.warmup) - core.start;
+        if (opt.gantt) opt.gantt->dispatch(c, procs[i].pid, core.start, time, core.switchCost, core.migration, core.warmup);
+        busy--;
+        core.running = -1;
+        core.lastRan = i;
+        core.stoppedAt = time;
+        core.version++;
+        return i;
+    };
+
     int time = 0;
+    vector<int> ended, admitted, woken;
+    auto nextEntry = [&]() { return min(work.nextArrival(), blocked.nextWake()); };
+    auto leastLoaded = [&]() {
+        int q = 0;
+        if (bal != BAL_GLOBAL) {
+            auto load = [&](int c) { return queued[c] + (cores[c].running >= 0); };
+            for (int c = 1; c < ncores; ++c) if (load(c) < load(q)) q = c;
+        }
+        return q;
+    };
+    while (true) {
+        while (!events.empty()) {
+            int t, c, v;
+            tie(t, c, v) = events.top();
+            if (cores[c].running >= 0 && cores[c].version == v) break;
+            events.pop();
+        }
+        // nothing running means nothing queued either
+        if (events.empty() && nextEntry() == INT_MAX) break;
+        // while every core is busy, arrivals and wake-ups only matter at the
+        // next slice end (unless they can preempt): they then queue together
+        time = INT_MAX;
+        if (busy < ncores || pol.preemptOnArrival) time = nextEntry();
+        if (!events.empty()) time = min(time, get<0>(events.top()));
+        for (auto &q : queues) q->setTime(time);
+        // charge running processes before arrivals are placed against them
+        if (pol.preemptOnArrival)
+            for (int c = 0; c < ncores; ++c) if (cores[c].running >= 0) sync(c, time);
 
-    while (finished < n) {
-        int idx = -1;
-        int bestPriority = INT_MAX;
-        for (int i = 0; i < n; ++i) {
-            if (!done[i] && procs[i].arrival <= time) {
-                if (procs[i].priority < bestPriority) {
-                    bestPriority = procs[i].priority;
-                    idx = i;
+        // arrivals in pid order, then processes done with I/O
+        admitted.clear();
+        work.admit(time, procs, admitted);
+        for (int i : admitted) enqueue(leastLoaded(), i);
+        woken.clear();
+        blocked.wake(time, woken);
+        for (int i : woken) {
+            int q = leastLoaded();
+            queues[q]->woke(i);
+            enqueue(q, i);
+        }
+
+        // slices ending now, in core order
+        ended.clear();
+        while (!events.empty() && get<0>(events.top()) == time) {
+            int c = get<1>(events.top()), v = get<2>(events.top());
+            events.pop();
+            if (cores[c].running >= 0 && cores[c].version == v) ended.push_back(c);
+        }
+        sort(ended.begin(), ended.end());
+        for (int c : ended) {
+            int i = stop(c, time);
+            if (procs[i].remaining > 0) enqueue(queueOf(c), i);
+            else if (!blocked.block(procs, i, time)) complete(work, procs, i, time);
+        }
+
+        // a better process arrived: preempt (per core, or the worst running one)
+        if (pol.preemptOnArrival && (!admitted.empty() || !woken.empty())) {
+            if (bal == BAL_GLOBAL) {
+                while (queued[0] > 0) {
+                    int worst = -1;
+                    for (int c = 0; c < ncores; ++c)
+                        if (cores[c].running >= 0 && (worst < 0 || queues[0]->before(cores[worst].running, cores[c].running))) worst = c;
+                    if (worst < 0 || !queues[0]->before(queues[0]->top(), cores[worst].running)) break;
+                    int i = dequeue(0);
+                    enqueue(0, stop(worst, time));
+                    start(worst, i, time);
+                }
+            } else {
+                for (int c = 0; c < ncores; ++c) {
+                    if (cores[c].running < 0 || queued[c] == 0 || !queues[c]->before(queues[c]->top(), cores[c].running)) continue;
+                    int i = dequeue(c);
+                    enqueue(c, stop(c, time));
+                    start(c, i, time);
                 }
             }
         }
 
-        if (idx == -1) {
-            time++;
-            continue;
+        // idle cores take work
+        for (int c = 0; c < ncores; ++c) {
+            if (cores[c].running >= 0) continue;
+            int q = queueOf(c);
+            if (queued[q] == 0 && bal == BAL_STEAL) {
+                for (int v = 0; v < ncores; ++v) if (queued[v] > queued[q]) q = v;
+            }
+            if (queued[q] > 0) start(c, dequeue(q), time);
         }
-
-        // run process to completion (non-preemptive)
-        time += procs[idx].burst;
-        procs[idx].completion = time;
-        procs[idx].turnaround = procs[idx].completion - procs[idx].arrival;
-        procs[idx].waiting = procs[idx].turnaround - procs[idx].burst;
-        done[idx] = true;
-        finished++;
     }
+    return stats;
+}
+
+vector<CoreStats> simulateSMP(vector<Process> &procs, const Policy &pol, int ncores, Balance bal, int migrationCost,
+                              const RunOptions &opt = RunOptions()) {
+    TableWorkload work(procs);
+    return simulateSMP(work, procs, pol, ncores, bal, migrationCost, opt);
+}
+
+// Nearest-rank percentile of sorted values
+int percentile(const vector<int> &sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = (size_t)max(1.0, ceil(p / 100 * sorted.size()));
+    return sorted[min(rank, sorted.size()) - 1];
+}
 
+void SMP(vector<Process> procs, const Policy &pol, int ncores, Balance bal, int migrationCost, const RunOptions &opt) {
+    const char *balName[] = {"global queue", "per-core queues", "work stealing"};
+    cout << "\n--- " << pol.name << " on " << ncores << " cores (" << balName[bal]
+         << ", migration cost " << migrationCost << ") ---\n";
+    vector<CoreStats> stats = simulateSMP(procs, pol, ncores, bal, migrationCost, opt);
     printTable(procs);
+
+    int makespan = 0, migrations = 0;
+    vector<int> tat, wt;
+    for (const auto &p : procs) { makespan = max(makespan, p.completion); tat.push_back(p.turnaround); wt.push_back(p.waiting); }
+    sort(tat.begin(), tat.end());
+    sort(wt.begin(), wt.end());
+
+    cout << "\nCore\tBusy\tUtil%\tRuns\tMigrated in\n";
+    for (int c = 0; c < ncores; ++c) {
+        migrations += stats[c].migrations;
+        cout << c << '\t' << stats[c].busy << '\t' << fixed << setprecision(1)
+             << (makespan ? 100.0 * stats[c].busy / makespan : 0.0) << '\t'
+             << stats[c].dispatches << '\t' << stats[c].migrations << '\n';
+    }
+    cout << "Makespan: " << makespan << "  Migrations: " << migrations << '\n';
+    CoreStats total;
+    for (const CoreStats &s : stats) total.switches += s.switches, total.overhead += s.overhead;
+    printOverheads(total, opt);
+    cout << "TAT p50/p90/p99: " << percentile(tat, 50) << " / " << percentile(tat, 90) << " / " << percentile(tat, 99) << '\n';
+    cout << "WT  p50/p90/p99: " << percentile(wt, 50) << " / " << percentile(wt, 90) << " / " << percentile(wt, 99) << '\n';
 }
 
-// 4) Round Robin (Preemptive)
-void RoundRobin(vector<Process> procs, int quantum) {
-    cout << "\n--- Round Robin (q = " << quantum << ") ---\n";
-    int n = procs.size();
-    for (auto &p : procs) p.remaining = p.burst;
+bool readMLFQ(MLFQConfig &cfg) {
+    cout << "Levels, base quantum, boost period, aging threshold (0 = off): ";
+    cin >> cfg.levels >> cfg.quantum >> cfg.boost >> cfg.aging;
+    return cfg.valid();
+}
 
-    queue<int> q;
-    int time = 0;
-    int finished = 0;
-    vector<bool> added(n, false);
+bool readCFS(CFSConfig &cfg) {
+    cout << "Target latency, min granularity, wakeup granularity: ";
+    cin >> cfg.latency >> cfg.minGranularity >> cfg.wakeupGranularity;
+    return cfg.latency > 0 && cfg.minGranularity > 0 && cfg.wakeupGranularity >= 0;
+}
 
-    // add processes that arrive at time 0
-    for (int i = 0; i < n; ++i) {
-        if (procs[i].arrival == 0) {
-            q.push(i);
-            added[i] = true;
+// --- Trace batch mode ---
+
+// Mergeable quantile sketch over non-negative integers (DDSketch): v > 0 is
+// counted in bucket ceil(log_g v) with g = (1 + a) / (1 - a), so a quantile
+// comes back within relative error a from O(log max) buckets. Zeros are
+// counted apart; merging adds bucket counts. Estimates never exceed the
+// largest value added.
+struct QuantileSketch {
+    static constexpr double ALPHA = 0.005;
+    double logGamma = log((1 + ALPHA) / (1 - ALPHA));
+    long long count = 0, zeros = 0, largest = 0;
+    vector<long long> buckets;
+
+    void add(long long v) {
+        count++;
+        largest = max(largest, v);
+        if (v <= 0) { zeros++; return; }
+        size_t b = (size_t)max(0.0, ceil(log((double)v) / logGamma));
+        if (b >= buckets.size()) buckets.resize(b + 1, 0);
+        buckets[b]++;
+    }
+    void merge(const QuantileSketch &o) {
+        count += o.count;
+        zeros += o.zeros;
+        largest = max(largest, o.largest);
+        if (o.buckets.size() > buckets.size()) buckets.resize(o.buckets.size(), 0);
+        for (size_t b = 0; b < o.buckets.size(); ++b) buckets[b] += o.buckets[b];
+    }
+    // nearest rank, like percentile()
+    long long quantile(double p) const {
+        if (count == 0) return 0;
+        long long rank = max(1LL, (long long)ceil(p / 100 * count));
+        if (rank <= zeros) return 0;
+        rank -= zeros;
+        for (size_t b = 0; b < buckets.size(); ++b) {
+            if (rank <= buckets[b]) return min(largest, llround(2 * exp(b * logGamma) / (1 + exp(logGamma))));
+            rank -= buckets[b];
+        }
+        return 0;
+    }
+};
+
+// Online aggregates over finished processes
+struct TraceStats {
+    long long count = 0, sumTAT = 0, sumWT = 0, work = 0;
+    int firstArrival = INT_MAX, lastCompletion = 0;
+    QuantileSketch tat, wt;
+
+    void add(const Process &p) {
+        count++;
+        sumTAT += p.turnaround;
+        sumWT += p.waiting;
+        work += p.burst;
+        firstArrival = min(firstArrival, p.arrival);
+        lastCompletion = max(lastCompletion, p.completion);
+        tat.add(p.turnaround);
+        wt.add(p.waiting);
+    }
+    void merge(const TraceStats &o) {
+        count += o.count;
+        sumTAT += o.sumTAT;
+        sumWT += o.sumWT;
+        work += o.work;
+        firstArrival = min(firstArrival, o.firstArrival);
+        lastCompletion = max(lastCompletion, o.lastCompletion);
+        tat.merge(o.tat);
+        wt.merge(o.wt);
+    }
+};
+
+// One process of a trace
+struct Record {
+    int arrival, burst, priority;   // burst: total CPU time
+    int io;                         // total I/O time
+    vector<int> bursts;             // CPU, I/O, CPU, ... when it does I/O
+};
+
+// A sequence of records in arrival order
+struct RecordSource {
+    virtual ~RecordSource() {}
+    virtual bool next(Record &r) = 0;
+};
+
+// Reads records from a file, which must come in arrival order. A path
+// ending in .bin holds int32 (arrival, burst, priority) triples in host byte
+// order; anything else is text with one record per line and fields split by
+// commas or blanks (blank lines, # comments and a leading header line are
+// skipped). A text record may go on with I/O, CPU burst pairs:
+// "arrival, burst, priority, io, burst, io, burst". "-" reads text from
+// stdin.
+struct TraceReader : RecordSource {
+    FILE *f = nullptr;
+    bool binary = false, headerAllowed = true;
+    vector<char> buf = vector<char>(1 << 20);
+    size_t pos = 0, len = 0;
+    long long records = 0, line = 0;
+    int lastArrival = 0;
+    string text, error;
+    vector<long long> fields;
+
+    ~TraceReader() { if (f && f != stdin) fclose(f); }
+    bool open(const string &path) {
+        binary = path.size() > 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+        f = path == "-" ? stdin : fopen(path.c_str(), binary ? "rb" : "r");
+        return f != nullptr;
+    }
+    int get() {
+        if (pos == len) {
+            len = fread(buf.data(), 1, buf.size(), f);
+            pos = 0;
+            if (len == 0) return EOF;
         }
+        return (unsigned char)buf[pos++];
+    }
+    bool fail(const string &what) {
+        error = (binary ? "record " + to_string(records + 1) : "line " + to_string(line)) + ": " + what;
+        return false;
     }
 
-    while (finished < n) {
-        if (q.empty()) {
-            // no process ready — advance time and add any arrived
-            time++;
-            for (int i = 0; i < n; ++i) {
-                if (!added[i] && procs[i].arrival <= time && procs[i].remaining > 0) {
-                    q.push(i);
-                    added[i] = true;
+    // next record; false at the end or on an error (then error is set)
+    bool next(Record &r) override {
+        if (!error.empty()) return false;
+        fields.clear();
+        if (binary) {
+            char rec[12];
+            for (int k = 0; k < 12; ++k) {
+                int c = get();
+                if (c == EOF) return k == 0 ? false : fail("truncated record");
+                rec[k] = (char)c;
+            }
+            for (int k = 0; k < 3; ++k) { int32_t x; memcpy(&x, rec + 4 * k, 4); fields.push_back(x); }
+        } else {
+            while (true) {
+                text.clear();
+                int c;
+                while ((c = get()) != EOF && c != '\n') text += (char)c;
+                if (c == EOF && text.empty()) return false;
+                line++;
+                const char *s = text.c_str();
+                while (*s == ' ' || *s == '\t' || *s == '\r') s++;
+                if (*s == '\0' || *s == '#') continue;
+                while (true) {
+                    while (*s == ' ' || *s == '\t' || *s == ',') s++;
+                    char *e;
+                    long long v = strtoll(s, &e, 10);
+                    if (e == s) break;
+                    fields.push_back(v);
+                    s = e;
                 }
+                while (*s == '\r') s++;
+                bool header = headerAllowed && fields.empty();
+                headerAllowed = false;
+                if (header) continue;
+                if (fields.size() < 3 || fields.size() % 2 == 0 || *s != '\0')
+                    return fail("expected arrival, burst, priority[, io, burst]...");
+                break;
             }
-            continue;
         }
+        records++;
+        const vector<long long> &v = fields;
+        if (v[0] < 0 || v[0] > INT_MAX) return fail("arrival must be in 0.." + to_string(INT_MAX));
+        if (v[2] < INT_MIN || v[2] > INT_MAX) return fail("priority must be in " + to_string(INT_MIN) + ".." + to_string(INT_MAX));
+        if (v[0] < lastArrival) return fail("trace is not sorted by arrival");
+        long long cpu = 0, io = 0;
+        r.bursts.clear();
+        // the bursts are fields 1, 3, 4, 5, ...: CPU at 1 and the even ones
+        for (size_t k = 1; k < v.size(); k += k == 1 ? 2 : 1) {
+            if (v[k] <= 0 || v[k] > INT_MAX) return fail("bursts must be in 1.." + to_string(INT_MAX));
+            (k == 1 || k % 2 == 0 ? cpu : io) += v[k];
+            if (v.size() > 3) r.bursts.push_back((int)v[k]);
+        }
+        if (cpu > INT_MAX || io > INT_MAX) return fail("bursts must add up to at most " + to_string(INT_MAX));
+        r.arrival = lastArrival = (int)v[0];
+        r.burst = (int)cpu;
+        r.priority = (int)v[2];
+        r.io = (int)io;
+        return true;
+    }
+};
 
-        int idx = q.front(); q.pop();
-        int run = min(quantum, procs[idx].remaining);
-        procs[idx].remaining -= run;
-        time += run;
+// A whole trace held as one array per field, shared read-only by the runs
+// of a sweep
+struct Trace {
+    vector<int> arrival, burst, priority, io;
+    // CPU/I/O sequences: record k's is seq[from[k] .. from[k + 1]); from
+    // stays empty while no record does I/O
+    vector<int> seq;
+    vector<size_t> from;
 
-        // add newly arrived processes during this quantum
-        for (int i = 0; i < n; ++i) {
-            if (!added[i] && procs[i].arrival <= time && procs[i].remaining > 0) {
-                q.push(i);
-                added[i] = true;
+    void load(RecordSource &in) {
+        Record r;
+        while (in.next(r)) {
+            if (!r.bursts.empty() && from.empty()) from.assign(arrival.size() + 1, 0);
+            arrival.push_back(r.arrival);
+            burst.push_back(r.burst);
+            priority.push_back(r.priority);
+            io.push_back(r.io);
+            if (!from.empty()) {
+                seq.insert(seq.end(), r.bursts.begin(), r.bursts.end());
+                from.push_back(seq.size());
             }
         }
+    }
+    size_t size() const { return arrival.size(); }
+};
+
+struct TraceCursor : RecordSource {
+    const Trace &trace;
+    size_t pos = 0;
+    TraceCursor(const Trace &trace) : trace(trace) {}
+    bool next(Record &r) override {
+        if (pos == trace.size()) return false;
+        r.arrival = trace.arrival[pos];
+        r.burst = trace.burst[pos];
+        r.priority = trace.priority[pos];
+        r.io = trace.io[pos];
+        r.bursts.clear();
+        if (!trace.from.empty()) r.bursts.assign(trace.seq.begin() + trace.from[pos], trace.seq.begin() + trace.from[pos + 1]);
+        pos++;
+        return true;
+    }
+};
+
+// Processes streamed from a trace: only those that have arrived and not yet
+// finished hold a slot in procs; finished ones feed the aggregates and give
+// their slot to the next arrival.
+struct TraceWorkload : Workload {
+    RecordSource &in;
+    TraceStats &stats;
+    vector<int> freeSlots;
+    int pid = 0;
+    Record rec;
+    bool more;
+    TraceWorkload(RecordSource &in, TraceStats &stats) : in(in), stats(stats) { more = in.next(rec); }
+
+    int nextArrival() const override { return more ? rec.arrival : INT_MAX; }
+    void admit(int time, vector<Process> &procs, vector<int> &admitted) override {
+        while (more && rec.arrival <= time) {
+            int i;
+            if (!freeSlots.empty()) { i = freeSlots.back(); freeSlots.pop_back(); }
+            else { i = procs.size(); procs.emplace_back(); }
+            Process &p = procs[i];
+            p.pid = ++pid;
+            p.arrival = rec.arrival;
+            p.burst = rec.burst;
+            p.priority = rec.priority;
+            p.io = rec.io;
+            p.bursts.swap(rec.bursts);
+            initRunState(p);
+            admitted.push_back(i);
+            more = in.next(rec);
+        }
+    }
+    void finish(vector<Process> &procs, int i) override {
+        stats.add(procs[i]);
+        freeSlots.push_back(i);
+    }
+};
+
+// Run one policy over a trace
+struct RunResult {
+    TraceStats stats;
+    long long busy = 0;     // core time spent on processes and overheads
+    long long overhead = 0; // of which switch, migration and warm-up time
+    long long switches = 0;
+    size_t peakLive = 0;    // most processes holding a slot at once
+    double seconds = 0;
+
+    long long span() const { return stats.count ? stats.lastCompletion - stats.firstArrival : 0; }
+    double throughput() const { return span() ? (double)stats.count / span() : 0.0; }
+    double utilisation(int cores) const { return span() ? 100.0 * busy / span() / cores : 0.0; }
+};
+
+RunResult runTrace(RecordSource &in, const Policy &policy, int cores, Balance bal, int migrationCost,
+                   const RunOptions &opt) {
+    auto t0 = chrono::steady_clock::now();
+    RunResult r;
+    TraceWorkload work(in, r.stats);
+    vector<Process> procs;
+    vector<CoreStats> stats;
+    if (cores == 1) {
+        unique_ptr<ReadyQueue> ready = makeQueue(procs, policy);
+        stats.push_back(simulate(work, procs, *ready, policy.quantum, policy.preemptOnArrival, opt));
+    } else {
+        stats = simulateSMP(work, procs, policy, cores, bal, migrationCost, opt);
+    }
+    for (const CoreStats &s : stats) {
+        r.busy += s.busy;
+        r.overhead += s.overhead;
+        r.switches += s.switches;
+    }
+    r.peakLive = procs.size();
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    return r;
+}
+
+// Parse "a,b,c" into ints; false on anything else
+bool parseInts(const char *s, vector<int> &out) {
+    out.clear();
+    while (true) {
+        char *e;
+        errno = 0;
+        long v = strtol(s, &e, 10);
+        if (e == s || errno == ERANGE || v < INT_MIN || v > INT_MAX) return false;
+        out.push_back((int)v);
+        s = e;
+        if (*s == '\0') return true;
+        if (*s++ != ',') return false;
+    }
+}
+
+// Parse "a,b,c" of names into their 1-based positions in names
+bool parseNames(const string &s, const vector<string> &names, vector<int> &out) {
+    out.clear();
+    size_t from = 0;
+    while (true) {
+        size_t comma = s.find(',', from);
+        auto it = find(names.begin(), names.end(), s.substr(from, comma - from));
+        if (it == names.end()) return false;
+        out.push_back(it - names.begin() + 1);
+        if (comma == string::npos) return true;
+        from = comma + 1;
+    }
+}
+
+const vector<string> POLICY_NAMES = {"fcfs", "sjf", "priority", "rr", "mlfq", "cfs"};
+const vector<string> BALANCE_NAMES = {"global", "percore", "steal"};
+
+// One configuration of a sweep and its result
+struct SweepRun {
+    int policy, quantum, cores;
+    RunResult result;
+};
+
+// Evaluate every run on threads workers that share the loaded trace
+void sweep(const Trace &trace, vector<SweepRun> &runs, const MLFQConfig &mlfq, const CFSConfig &cfs,
+           Balance bal, int migrationCost, const RunOptions &opt, int threads) {
+    atomic<size_t> next(0);
+    vector<thread> pool;
+    for (int t = 0; t < max(1, min(threads, (int)runs.size())); t++)
+        pool.emplace_back([&]() {
+            for (size_t i; (i = next++) < runs.size(); ) {
+                SweepRun &run = runs[i];
+                MLFQConfig m = mlfq;
+                if (run.policy == 5) m.quantum = run.quantum;
+                TraceCursor in(trace);
+                run.result = runTrace(in, makePolicy(run.policy, run.policy == 4 ? run.quantum : 0, m, cfs),
+                                      run.cores, bal, migrationCost, opt);
+            }
+        });
+    for (thread &t : pool) t.join();
+}
 
-        if (procs[idx].remaining == 0) {
-            finished++;
-            procs[idx].completion = time;
-            procs[idx].turnaround = procs[idx].completion - procs[idx].arrival;
-            procs[idx].waiting = procs[idx].turnaround - procs[idx].burst;
+// One row per run; JSON (an array of objects) or CSV with the same fields
+void writeReport(ostream &out, const vector<SweepRun> &runs, bool json) {
+    const char *fields[] = {"policy", "quantum", "cores", "processes", "span", "throughput", "utilisation", "switches", "overhead",
+                            "tat_mean", "tat_p50", "tat_p99", "tat_p999", "tat_max",
+                            "wt_mean", "wt_p50", "wt_p99", "wt_p999", "wt_max", "seconds"};
+    const int nfields = sizeof fields / sizeof fields[0];
+    if (json) out << "[\n";
+    else for (int f = 0; f < nfields; ++f) out << fields[f] << (f + 1 < nfields ? "," : "\n");
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const SweepRun &run = runs[i];
+        const RunResult &r = run.result;
+        const TraceStats &s = r.stats;
+        double count = max(1LL, s.count);
+        ostringstream v[nfields];
+        v[0] << (json ? "\"" : "") << POLICY_NAMES[run.policy - 1] << (json ? "\"" : "");
+        v[1] << run.quantum;
+        v[2] << run.cores;
+        v[3] << s.count;
+        v[4] << r.span();
+        v[5] << fixed << setprecision(6) << r.throughput();
+        v[6] << fixed << setprecision(2) << r.utilisation(run.cores);
+        v[7] << r.switches;
+        v[8] << r.overhead;
+        v[9] << fixed << setprecision(2) << s.sumTAT / count;
+        v[10] << s.tat.quantile(50);
+        v[11] << s.tat.quantile(99);
+        v[12] << s.tat.quantile(99.9);
+        v[13] << s.tat.largest;
+        v[14] << fixed << setprecision(2) << s.sumWT / count;
+        v[15] << s.wt.quantile(50);
+        v[16] << s.wt.quantile(99);
+        v[17] << s.wt.quantile(99.9);
+        v[18] << s.wt.largest;
+        v[19] << fixed << setprecision(3) << r.seconds;
+        if (json) {
+            out << "  {";
+            for (int f = 0; f < nfields; ++f) out << (f ? ", " : "") << '"' << fields[f] << "\": " << v[f].str();
+            out << (i + 1 < runs.size() ? "},\n" : "}\n");
         } else {
-            // not finished, put back to queue
-            q.push(idx);
+            for (int f = 0; f < nfields; ++f) out << v[f].str() << (f + 1 < nfields ? "," : "\n");
         }
     }
+    if (json) out << "]\n";
+}
 
-    printTable(procs);
+// Usage: SchedulingAlgos -t TRACE [-p POLICY] [-q QUANTUM] [-c CORES] [-b BALANCE] [-m COST]
+//                        [-x SWITCH] [-w WARMUP] [--mlfq LEVELS,BOOST,AGING] [--cfs LATENCY,MIN,WAKEUP]
+//                        [-g GANTT | -S [-j N] [-o REPORT]]
+//   -t  stream TRACE (see TraceReader) and print a summary in place of the
+//       per-process table; without arguments the program asks for processes
+//   -p  fcfs, sjf, priority, rr, mlfq or cfs (default fcfs)
+//   -q  Round Robin quantum (default 4) or MLFQ base quantum (default 2)
+//   -c  cores (default 1, at most MAX_CORES); -b global, percore or steal (default global);
+//       -m migration cost (default 0)
+//   -x  context switch cost and -w cache warm-up cost (see RunOptions)
+//   -g  write the schedule to GANTT (see GanttWriter)
+//   -S  sweep: load TRACE once and run every combination of the comma
+//       separated -p, -q and -c lists (-q only multiplies rr and mlfq) on
+//       -j threads (default: all hardware threads); the report goes to
+//       REPORT, as JSON if it ends in .json and CSV otherwise (default: CSV
+//       on stdout)
+int batch(int argc, char *argv[]) {
+    const char *usage = "Usage: SchedulingAlgos -t TRACE [-p fcfs|sjf|priority|rr|mlfq|cfs] [-q QUANTUM] [-c CORES]"
+                        " [-b global|percore|steal] [-m COST] [-x SWITCH] [-w WARMUP] [--mlfq LEVELS,BOOST,AGING]"
+                        " [--cfs LATENCY,MIN,WAKEUP] [-g GANTT | -S [-j THREADS] [-o REPORT]]\n";
+    string trace, report, ganttPath;
+    vector<int> pols{1}, quanta, coreCounts{1}, balance{1}, v;
+    int cost = 0, threads = max(1u, thread::hardware_concurrency());
+    bool sweeping = false;
+    MLFQConfig mlfq;
+    CFSConfig cfs;
+    RunOptions opt;
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        bool ok = true;
+        if (a == "-S") sweeping = true;
+        else if (i + 1 == argc) ok = false;
+        else if (a == "-t") trace = argv[++i];
+        else if (a == "-o") report = argv[++i];
+        else if (a == "-j") threads = atoi(argv[++i]);
+        else if (a == "-m") cost = atoi(argv[++i]);
+        else if (a == "-x") opt.contextSwitch = atoi(argv[++i]);
+        else if (a == "-w") opt.warmup = atoi(argv[++i]);
+        else if (a == "-g") ganttPath = argv[++i];
+        else if (a == "-q") ok = parseInts(argv[++i], quanta);
+        else if (a == "-c") ok = parseInts(argv[++i], coreCounts);
+        else if (a == "-p") ok = parseNames(argv[++i], POLICY_NAMES, pols);
+        else if (a == "-b") ok = parseNames(argv[++i], BALANCE_NAMES, balance) && balance.size() == 1;
+        else if (a == "--mlfq") {
+            ok = parseInts(argv[++i], v) && v.size() == 3;
+            if (ok) mlfq.levels = v[0], mlfq.boost = v[1], mlfq.aging = v[2];
+        }
+        else if (a == "--cfs") {
+            ok = parseInts(argv[++i], v) && v.size() == 3;
+            if (ok) cfs.latency = v[0], cfs.minGranularity = v[1], cfs.wakeupGranularity = v[2];
+        }
+        else ok = false;
+        if (!ok) { cerr << usage; return 1; }
+    }
+    bool valid = !trace.empty() && cost >= 0 && opt.contextSwitch >= 0 && opt.warmup >= 0 && threads >= 1 && mlfq.valid() &&
+                 cfs.latency > 0 && cfs.minGranularity > 0 && cfs.wakeupGranularity >= 0;
+    bool mlfqRuns = find(pols.begin(), pols.end(), 5) != pols.end();
+    for (int q : quanta) valid = valid && q > 0 && (!mlfqRuns || q <= MLFQConfig::maxQuantum(mlfq.levels));
+    for (int c : coreCounts) valid = valid && c >= 1 && c <= MAX_CORES;
+    if (sweeping) valid = valid && ganttPath.empty();
+    else valid = valid && pols.size() == 1 && quanta.size() <= 1 && coreCounts.size() == 1 && report.empty();
+    if (!valid) { cerr << usage; return 1; }
+    Balance bal = Balance(balance[0] - 1);
+
+    TraceReader in;
+    if (!in.open(trace)) { cerr << "Error: cannot open " << trace << "\n"; return 1; }
+
+    if (sweeping) {
+        Trace loaded;
+        loaded.load(in);
+        if (!in.error.empty()) { cerr << "Error: " << trace << ": " << in.error << "\n"; return 1; }
+        vector<SweepRun> runs;
+        for (int pol : pols)
+            for (int c : coreCounts) {
+                vector<int> qs = quanta;
+                if (pol != 4 && pol != 5) qs = {0};
+                else if (qs.empty()) qs = {pol == 4 ? 4 : mlfq.quantum};
+                for (int q : qs) runs.push_back({pol, q, c, RunResult()});
+            }
+        auto t0 = chrono::steady_clock::now();
+        sweep(loaded, runs, mlfq, cfs, bal, cost, opt, threads);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+        bool json = report.size() > 5 && report.compare(report.size() - 5, 5, ".json") == 0;
+        if (report.empty()) writeReport(cout, runs, false);
+        else {
+            ofstream out(report);
+            if (!out) { cerr << "Error: cannot write " << report << "\n"; return 1; }
+            writeReport(out, runs, json);
+        }
+        cerr << "Sweep: " << runs.size() << " configuration(s) over " << loaded.size() << " processes on "
+             << min(threads, (int)runs.size()) << " thread(s) in " << fixed << setprecision(2) << seconds << "s\n";
+        return 0;
+    }
+
+    int pol = pols[0], q = quanta.empty() ? 0 : quanta[0], cores = coreCounts[0];
+    if (pol == 4 && q == 0) q = 4;
+    if (pol == 5 && q != 0) mlfq.quantum = q;
+    if (pol != 4) q = 0;
+    Policy policy = makePolicy(pol, q, mlfq, cfs);
+    GanttWriter gantt;
+    if (!ganttPath.empty()) {
+        if (!gantt.open(ganttPath, cores)) { cerr << "Error: cannot write " << ganttPath << "\n"; return 1; }
+        opt.gantt = &gantt;
+    }
+    RunResult r = runTrace(in, policy, cores, bal, cost, opt);
+    if (!in.error.empty()) { cerr << "Error: " << trace << ": " << in.error << "\n"; return 1; }
+    if (opt.gantt && !gantt.close()) { cerr << "Error: cannot write " << ganttPath << "\n"; return 1; }
+
+    const TraceStats &stats = r.stats;
+    cout << "--- " << policy.name << " on " << cores << " core(s): " << trace << " ---\n";
+    cout << "Processes: " << stats.count << "  Span: " << r.span() << " (" << (stats.count ? stats.firstArrival : 0)
+         << " .. " << stats.lastCompletion << ")  Peak live: " << r.peakLive << '\n';
+    cout << fixed << setprecision(4) << "Throughput: " << r.throughput() << " per time unit"
+         << setprecision(1) << "  CPU utilisation: " << r.utilisation(cores) << "%\n";
+    cout << "Context switches: " << r.switches << "  Overhead: " << r.overhead << " ("
+         << (r.busy ? 100.0 * r.overhead / r.busy : 0.0) << "% of busy time)\n";
+    cout << "\n\tmean\tp50\tp99\tp999\tmax\n";
+    auto row = [&](const char *name, long long sum, const QuantileSketch &s) {
+        cout << name << '\t' << setprecision(2) << (stats.count ? (double)sum / stats.count : 0.0) << '\t'
+             << s.quantile(50) << '\t' << s.quantile(99) << '\t' << s.quantile(99.9) << '\t' << s.largest << '\n';
+    };
+    row("TAT", stats.sumTAT, stats.tat);
+    row("WT", stats.sumWT, stats.wt);
+    cout << "(percentiles within " << QuantileSketch::ALPHA * 100 << "%)\n";
+    if (opt.gantt) cout << "Gantt: " << gantt.records << " records -> " << ganttPath << '\n';
+    return 0;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+    if (argc > 1) return batch(argc, argv);
+
     int n;
     cout << "Number of processes: ";
     cin >> n;
@@ -194,19 +1364,57 @@ int main() {
         procs[i].pid = i + 1;
         cout << "Enter arrival, burst, priority for P" << i+1 << " : ";
         cin >> procs[i].arrival >> procs[i].burst >> procs[i].priority;
+        if (procs[i].arrival < 0 || procs[i].burst <= 0) {
+            cout << "Arrival must be >= 0 and burst > 0\n";
+            return 1;
+        }
     }
 
+    RunOptions opt;
     while (true) {
-        cout << "\nMenu:\n1) FCFS\n2) SJF (Preemptive)\n3) Priority (Non-preemptive)\n4) Round Robin\n5) Exit\nChoose: ";
-        int choice; cin >> choice;
-        if (choice == 1) FCFS(procs);
-        else if (choice == 2) SJF_Preemptive(procs);
-        else if (choice == 3) Priority_NonPreemptive(procs);
+        cout << "\nMenu:\n1) FCFS\n2) SJF (Preemptive)\n3) Priority (Non-preemptive)\n4) Round Robin\n5) Exit\n6) Multi-core (SMP)\n7) MLFQ\n8) CFS\n9) Switch costs\nChoose: ";
+        int choice;
+        if (!(cin >> choice)) break;     // end of input: leave instead of looping
+        if (choice == 1) FCFS(procs, opt);
+        else if (choice == 2) SJF_Preemptive(procs, opt);
+        else if (choice == 3) Priority_NonPreemptive(procs, opt);
         else if (choice == 4) {
             int q; cout << "Time quantum: "; cin >> q;
-            RoundRobin(procs, q);
+            if (q > 0) RoundRobin(procs, q, opt);
+            else cout << "Time quantum must be > 0\n";
         }
         else if (choice == 5) break;
+        else if (choice == 6) {
+            int cores, bal, cost, pol, q = 0;
+            MLFQConfig mlfq;
+            CFSConfig cfs;
+            cout << "Cores: "; cin >> cores;
+            cout << "Balancing (1 global queue, 2 per-core queues, 3 work stealing): "; cin >> bal;
+            cout << "Migration cost: "; cin >> cost;
+            cout << "Policy (1 FCFS, 2 SJF, 3 Priority, 4 RR, 5 MLFQ, 6 CFS): "; cin >> pol;
+            if (pol == 4) { cout << "Time quantum: "; cin >> q; }
+            if (pol == 5 && !readMLFQ(mlfq)) pol = 0;
+            if (pol == 6 && !readCFS(cfs)) pol = 0;
+            if (cores < 1 || cores > MAX_CORES || bal < 1 || bal > 3 || cost < 0 || pol < 1 || pol > 6 || (pol == 4 && q <= 0))
+                cout << "Invalid option\n";
+            else SMP(procs, makePolicy(pol, q, mlfq, cfs), cores, Balance(bal - 1), cost, opt);
+        }
+        else if (choice == 7) {
+            MLFQConfig cfg;
+            if (readMLFQ(cfg)) MLFQ(procs, cfg, opt);
+            else cout << "Invalid option\n";
+        }
+        else if (choice == 8) {
+            CFSConfig cfg;
+            if (readCFS(cfg)) CFS(procs, cfg, opt);
+            else cout << "Invalid option\n";
+        }
+        else if (choice == 9) {
+            int sw, wu;
+            cout << "Context switch cost, cache warm-up cost: "; cin >> sw >> wu;
+            if (sw >= 0 && wu >= 0) opt.contextSwitch = sw, opt.warmup = wu;
+            else cout << "Costs must be >= 0\n";
+        }
         else cout << "Invalid option\n";
     }
 
@@ -0,0 +1,147 @@
+// Throughput benchmark for pass1/pass2.
+// Generates synthetic sources, runs the built assemblers with -s in a scratch
+// directory and reports lines/sec and allocated bytes for Pass 1, the Pass 2
+// table loaders and Pass 2 itself, with the peak RSS of the process each
+// phase ran in up to the end of that phase (the loaders' figure is pass2's
+// process at that point, Pass 2's includes the loaders).
+//
+// Usage: asm_bench [-d DIR] [-n SYMBOLS] [-r RUNS] [-t] [scenario...]
+//   -d  directory holding the pass1 and pass2 executables (default .)
+//   -n  instruction labels per generated source (default 100000)
+//   -r  runs per scenario; the fastest is reported (default 3)
+//   -t  hand the IC over as intermediate.txt instead of intermediate.bin
+// Scenarios: baseline forward literals origin-equ ds-heavy (default: all)
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <filesystem>
+#include <unistd.h>
+using namespace std;
+
+struct Scenario {
+    string name;
+    double forward;     // share of symbol operands that refer to a later label
+    double literal;     // share of operands that are literals
+    int ltorgEvery;     // lines between LTORG (0 = only at END)
+    int equEvery;       // lines between an EQU + ORIGIN pair (0 = none)
+    int dsSize;         // size of each data DS block (0 = DC words instead)
+};
+
+const vector<Scenario> SCENARIOS = {
+    {"baseline",   0.5, 0.0,  0,  0,  0},
+    {"forward",    1.0, 0.0,  0,  0,  0},
+    {"literals",   0.5, 0.4, 50,  0,  0},
+    {"origin-equ", 0.5, 0.1, 200, 20, 0},
+    {"ds-heavy",   0.5, 0.0,  0,  0, 64},
+};
+
+void generate(const Scenario &sc, int n, const string &path) {
+    mt19937 rng(12345);
+    uniform_real_distribution<double> coin(0, 1);
+    const char *ops[] = {"MOVER", "MOVEM", "ADD", "SUB", "MULT", "COMP", "DIV"};
+    const char *regs[] = {"AREG", "BREG", "CREG", "DREG"};
+    ofstream out(path);
+    out << "START 100\n";
+    for (int i = 0; i < n; i++) {
+        out << "L" << i << " ";
+        if (i % 16 == 15) out << "BC ANY, L" << (coin(rng) < sc.forward ? min(n - 1, i + 1 + (int)(rng() % 64)) : (int)(rng() % (i + 1))) << "\n";
+        else {
+            out << ops[rng() % 7] << " " << regs[rng() % 4] << ", ";
+            if (coin(rng) < sc.literal) out << "='" << rng() % 100 << "'\n";
+            else if (coin(rng) < sc.forward) out << "D" << rng() % n << "\n";
+            else out << "L" << rng() % (i + 1) << "\n";
+        }
+        if (sc.ltorgEvery && i % sc.ltorgEvery == sc.ltorgEvery - 1) out << "LTORG\n";
+        if (sc.equEvery && i % sc.equEvery == sc.equEvery - 1) {
+            out << "E" << i << " EQU L" << i << "+1\n";
+            out << "ORIGIN E" << i << "\n";
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        if (sc.dsSize) out << "D" << i << " DS " << sc.dsSize << "\n";
+        else out << "D" << i << " DC " << rng() % 1000 << "\n";
+    }
+    out << "END\n";
+}
+
+struct Stat { long lines = 0; double seconds = 1e30; long allocBytes = 0, allocs = 0, processPeakRssKb = 0; };
+
+// Run one command in dir and collect its STAT lines by phase
+bool runStats(const string &dir, const string &cmd, map<string, Stat> &best) {
+    FILE *p = popen(("cd '" + dir + "' && " + cmd + " 2>/dev/null").c_str(), "r");
+    if (!p) return false;
+    char buf[512];
+    while (fgets(buf, sizeof buf, p)) {
+        char phase[64];
+        Stat s;
+        if (sscanf(buf, "STAT %63s lines=%ld seconds=%lf alloc_bytes=%ld allocs=%ld process_peak_rss_kb=%ld", phase,
+                   &s.lines, &s.seconds, &s.allocBytes, &s.allocs, &s.processPeakRssKb) != 6) continue;
+        if (s.seconds < best[phase].seconds) best[phase] = s;
+    }
+    return pclose(p) == 0;
+}
+
+int main(int argc, char *argv[]) {
+    string binDir = ".";
+    int n = 100000, runs = 3;
+    bool textIC = false;
+    vector<Scenario> chosen;
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        if (a == "-d" && i + 1 < argc) binDir = argv[++i];
+        else if (a == "-n" && i + 1 < argc) n = max(1, atoi(argv[++i]));
+        else if (a == "-r" && i + 1 < argc) runs = max(1, atoi(argv[++i]));
+        else if (a == "-t") textIC = true;
+        else {
+            bool found = false;
+            for (const Scenario &sc : SCENARIOS) if (sc.name == a) { chosen.push_back(sc); found = true; }
+            if (!found) { cerr << "Usage: asm_bench [-d DIR] [-n SYMBOLS] [-r RUNS] [-t] [scenario...]\n"; return 1; }
+        }
+    }
+    if (chosen.empty()) chosen = SCENARIOS;
+
+    char resolved[PATH_MAX];
+    if (!realpath(binDir.c_str(), resolved)) { cerr << "Error: " << binDir << " not found\n"; return 1; }
+    string pass1 = string(resolved) + "/pass1", pass2 = string(resolved) + "/pass2";
+    char scratch[] = "/tmp/asm_bench.XXXXXX";
+    if (!mkdtemp(scratch)) { cerr << "Error: cannot create scratch directory\n"; return 1; }
+    string flag = textIC ? "" : " -b";
+    auto cleanup = [&]() {
+        error_code ec;
+        filesystem::remove_all(scratch, ec);
+        if (ec) cerr << "Error: cannot remove " << scratch << ": " << ec.message() << "\n";
+        return !ec;
+    };
+
+    cout << left << setw(12) << "scenario" << setw(9) << "phase" << right << setw(10) << "lines"
+         << setw(14) << "lines/sec" << setw(12) << "alloc MB" << setw(11) << "allocs" << setw(14) << "proc RSS MB" << "\n";
+    for (const Scenario &sc : chosen) {
+        generate(sc, n, string(scratch) + "/input.txt");
+        map<string, Stat> best;
+        for (int r = 0; r < runs; r++) {
+            if (!runStats(scratch, "'" + pass1 + "' -s" + flag, best) ||
+                !runStats(scratch, "'" + pass2 + "' -s" + flag, best)) {
+                cerr << "Error: " << sc.name << ": assembler run failed\n";
+                cleanup();
+                return 1;
+            }
+        }
+        for (const char *phase : {"pass1", "loaders", "pass2"}) {
+            const Stat &s = best[phase];
+            cout << left << setw(12) << sc.name << setw(9) << phase << right << setw(10) << s.lines
+                 << setw(14) << fixed << setprecision(0) << (s.seconds > 0 ? s.lines / s.seconds : 0)
+                 << setw(12) << setprecision(1) << s.allocBytes / 1048576.0 << setw(11) << s.allocs
+                 << setw(14) << s.processPeakRssKb / 1024.0 << "\n";
+        }
+    }
+
+    return cleanup() ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+// Definitions shared by pass1.cpp and pass2.cpp
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <array>
+#include <stdexcept>
+#include <vector>
+#include <iomanip>
+using namespace std;
+
+enum ICClass : uint8_t { IC_IS = 1, IC_AD = 2, IC_DL = 3 };
+
+// --- Mnemonic classifier (MOT, AD, DL, REG and CC in one table) ---
+// For instructions and directives the kind is the IC class itself.
+enum MnemonicKind : uint8_t { MN_NONE = 0, MN_IS = IC_IS, MN_AD = IC_AD, MN_DL = IC_DL, MN_REG, MN_CC };
+struct Mnemonic { string_view name; MnemonicKind kind; uint8_t code; };
+
+constexpr Mnemonic MNEMONICS[] = {
+    {"STOP", MN_IS, 0}, {"ADD", MN_IS, 1}, {"SUB", MN_IS, 2}, {"MULT", MN_IS, 3},
+    {"MOVER", MN_IS, 4}, {"MOVEM", MN_IS, 5}, {"COMP", MN_IS, 6}, {"BC", MN_IS, 7},
+    {"DIV", MN_IS, 8}, {"READ", MN_IS, 9}, {"PRINT", MN_IS, 10},
+    {"START", MN_AD, 1}, {"END", MN_AD, 2}, {"ORIGIN", MN_AD, 3}, {"EQU", MN_AD, 4}, {"LTORG", MN_AD, 5},
+    {"DC", MN_DL, 1}, {"DS", MN_DL, 2},
+    {"AREG", MN_REG, 1}, {"BREG", MN_REG, 2}, {"CREG", MN_REG, 3}, {"DREG", MN_REG, 4},
+    {"LT", MN_CC, 1}, {"LE", MN_CC, 2}, {"EQ", MN_CC, 3}, {"GT", MN_CC, 4}, {"GE", MN_CC, 5}, {"ANY", MN_CC, 6},
+};
+
+// Perfect for the names above (checked when the table is built); anything
+// else lands on a slot whose name does not match
+constexpr size_t mnemonicSlot(string_view s) {
+    return (s.size() + (unsigned char)s[0] * 36u + (unsigned char)s[1] + (unsigned char)s.back() * 38u) % 64;
+}
+
+constexpr array<Mnemonic, 64> buildMnemonicTable() {
+    array<Mnemonic, 64> t{};
+    for (const Mnemonic &m : MNEMONICS) {
+        Mnemonic &slot = t[mnemonicSlot(m.name)];
+        if (slot.kind != MN_NONE) throw logic_error("mnemonic hash collision");
+        slot = m;
+    }
+    return t;
+}
+
+constexpr array<Mnemonic, 64> MNEMONIC_TABLE = buildMnemonicTable();
+
+// One probe: hash, then a single name compare
+constexpr Mnemonic classifyMnemonic(string_view s) {
+    if (s.size() < 2 || s.size() > 6) return {s, MN_NONE, 0};
+    const Mnemonic &m = MNEMONIC_TABLE[mnemonicSlot(s)];
+    if (m.name != s) return {s, MN_NONE, 0};
+    return m;
+}
+
+static_assert(classifyMnemonic("MOVEM").code == 5 && classifyMnemonic("LTORG").kind == MN_AD, "mnemonic table");
+static_assert(classifyMnemonic("DREG").kind == MN_REG && classifyMnemonic("LOOP").kind == MN_NONE, "mnemonic table");
+
+// Class tag of a text IC operand such as "(IS,04)"
+constexpr uint8_t icClassFromTag(string_view tag) {
+    return tag == "IS" ? IC_IS : tag == "AD" ? IC_AD : tag == "DL" ? IC_DL : 0;
+}
+enum ICOperand : uint8_t { OP_NONE = 0, OP_R, OP_CC, OP_S, OP_L, OP_C };
+
+// One intermediate-code line as a fixed-width record (intermediate.bin)
+struct ICRecord {
+    int32_t lc = -1;          // -1 for lines without a location (END, LTORG, ORIGIN, EQU)
+    uint8_t cls = 0;          // ICClass
+    uint8_t opcode = 0;
+    uint8_t regKind = OP_NONE;  // OP_R or OP_CC
+    uint8_t reg = 0;
+    uint8_t memKind = OP_NONE;  // OP_S / OP_L (1-based table index) or OP_C (constant)
+    uint8_t pad[3] = {0, 0, 0};
+    int32_t mem = 0;
+};
+static_assert(sizeof(ICRecord) == 16, "ICRecord must stay fixed-width");
+
+inline const char *icClassName(int cls) {
+    switch (cls) { case IC_IS: return "IS"; case IC_AD: return "AD"; case IC_DL: return "DL"; }
+    return "??";
+}
+
+inline const char *icOperandName(int kind) {
+    switch (kind) { case OP_R: return "R"; case OP_CC: return "CC"; case OP_S: return "S";
+                    case OP_L: return "L"; case OP_C: return "C"; }
+    return "?";
+}
+
+// Text form, e.g. "101 (IS,05) (R,1) (S,1) " - the debug dump in intermediate.txt
+inline void writeICText(ostream &out, const ICRecord &r) {
+    if (r.lc >= 0) out << r.lc << " ";
+    out << "(" << icClassName(r.cls) << "," << setw(2) << setfill('0') << (int)r.opcode << ")";
+    if (r.cls == IC_IS) {
+        out << " ";
+        if (r.regKind != OP_NONE) out << "(" << icOperandName(r.regKind) << "," << (int)r.reg << ") ";
+        if (r.memKind != OP_NONE) out << "(" << icOperandName(r.memKind) << "," << r.mem << ") ";
+    }
+    else if (r.memKind != OP_NONE) out << " (" << icOperandName(r.memKind) << "," << r.mem << ")";
+    out << "\n";
+}
+
+// Inverse of writeICText; returns false for blank or malformed lines
+inline bool parseICText(const string &line, ICRecord &r) {
+    stringstream ss(line);
+    string tok;
+    r = ICRecord();
+    if (!(ss >> tok)) return false;
+    if (tok[0] != '(') {
+        r.lc = stoi(tok);
+        if (!(ss >> tok)) return false;
+    }
+    if (tok.size() < 7 || tok[0] != '(') return false;
+    r.cls = icClassFromTag(string_view(tok).substr(1, 2));
+    r.opcode = (uint8_t)stoi(tok.substr(4, 2));
+    while (ss >> tok) {
+        size_t comma = tok.find(',');
+        if (tok[0] != '(' || comma == string::npos) continue;
+        string kind = tok.substr(1, comma - 1);
+        int val = stoi(tok.substr(comma + 1, tok.size() - comma - 2));
+        if (kind == "R" || kind == "CC") { r.regKind = kind == "R" ? OP_R : OP_CC; r.reg = (uint8_t)val; }
+        else { r.memKind = kind == "S" ? OP_S : kind == "L" ? OP_L : OP_C; r.mem = val; }
+    }
+    return r.cls != 0;
+}
+
+inline void writeICBinary(const string &path, const vector<ICRecord> &ic) {
+    ofstream out(path, ios::binary);
+    out.write((const char *)ic.data(), ic.size() * sizeof(ICRecord));
+}
+
+// Whole file in one read; no per-line parsing
+inline bool readICBinary(const string &path, vector<ICRecord> &ic) {
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in) return false;
+    streamsize bytes = in.tellg();
+    in.seekg(0);
+    ic.resize(bytes / sizeof(ICRecord));
+    return (bool)in.read((char *)ic.data(), ic.size() * sizeof(ICRecord));
+}
+
+// 1-based (S,n)/(L,n) index -> address; works on Pass 1's and Pass 2's tables alike
+template <class Table>
+int tableAddr(const Table &t, int index) {
+    if (index - 1 < (int)t.size())
+        return t[index - 1].addr;
+    return -1;
+}
+
+// One resolved machine-code line; repeat > 1 only for DS blocks
+struct MachineWord {
+    uint8_t opcode = 0;
+    uint8_t reg = 0;
+    int32_t mem = 0;
+    int32_t repeat = 1;
+};
+
+inline void writeMachineWord(ostream &mcFile, int opcode, int reg, int mem) {
+    mcFile << setfill('0') << setw(2) << opcode << " "
+           << reg << " "
+           << setfill('0') << setw(3) << mem << "\n";
+}
+
+// Pass 2 proper: machine code for decoded IC records against resolved tables
+template <class SymTab, class LitTab>
+void generateMachineCode(const vector<ICRecord> &ic, const SymTab &symtab, const LitTab &littab, ostream &mcFile) {
+    for (const ICRecord &r : ic) {
+        if (r.cls == IC_IS) {
+            int regField = r.regKind != OP_NONE ? r.reg : 0;
+            int memField = 0;
+            if (r.memKind == OP_S) memField = tableAddr(symtab, r.mem);
+            else if (r.memKind == OP_L) memField = tableAddr(littab, r.mem);
+            writeMachineWord(mcFile, r.opcode, regField, memField);
+        }
+        else if (r.cls == IC_DL && r.opcode == 1) {
+            writeMachineWord(mcFile, 0, 0, r.mem);
+        }
+        else if (r.cls == IC_DL && r.opcode == 2) {
+            for (int i = 0; i < r.mem; i++) {
+                writeMachineWord(mcFile, 0, 0, 0);
+            }
+        }
+    }
+}
+
+// --- Object file (machinecode.obj) ---
+// Little-endian, in listing order:
+//   ObjHeader
+//   nrecords x { ObjRecord, then for OBJ_CODE count x ObjWord }
+//   nreloc x int32 address of a word whose mem field holds a relocatable address
+// DS blocks are OBJ_BSS records (address and size only), never expanded.
+enum ObjRecordKind : uint8_t { OBJ_CODE = 1, OBJ_BSS = 2 };
+struct ObjHeader { char magic[4] = {'L', 'P', 'O', 'B'}; uint32_t version = 1; int32_t start = 0;
+                   uint32_t nrecords = 0; uint32_t nreloc = 0; };
+struct ObjRecord { uint8_t kind = OBJ_CODE; uint8_t pad[3] = {0, 0, 0}; int32_t addr = 0; int32_t count = 0; };
+struct ObjWord { uint8_t opcode = 0; uint8_t reg = 0; uint8_t pad[2] = {0, 0}; int32_t mem = 0; };
+static_assert(sizeof(ObjHeader) == 20 && sizeof(ObjRecord) == 12 && sizeof(ObjWord) == 8, "object layout");
+
+// Same words as generateMachineCode, packed. A symbol operand is relocated
+// unless its table entry says otherwise (EQU to a plain number); literal
+// operands always are. Without withReloc the table is left empty.
+template <class SymTab, class LitTab>
+void writeObject(const string &path, const vector<ICRecord> &ic, const SymTab &symtab, const LitTab &littab,
+                 bool withReloc) {
+    ObjHeader hdr;
+    vector<ObjRecord> recs;
+    vector<vector<ObjWord>> words;
+    vector<int32_t> reloc;
+    auto addWord = [&](int lc, const ObjWord &w) {
+        if (recs.empty() || recs.back().kind != OBJ_CODE || recs.back().addr + recs.back().count != lc) {
+            ObjRecord rec; rec.addr = lc; recs.push_back(rec); words.emplace_back();
+        }
+        recs.back().count++;
+        words.back().push_back(w);
+    };
+    for (const ICRecord &r : ic) {
+        if (r.cls == IC_AD && r.opcode == 1) hdr.start = r.lc;
+        else if (r.cls == IC_IS) {
+            ObjWord w; w.opcode = r.opcode; w.reg = r.regKind != OP_NONE ? r.reg : 0;
+            if (r.memKind == OP_S) {
+                w.mem = tableAddr(symtab, r.mem);
+                if (w.mem != -1 && symtab[r.mem - 1].relocatable) reloc.push_back(r.lc);
+            }
+            else if (r.memKind == OP_L) {
+                w.mem = tableAddr(littab, r.mem);
+                if (w.mem != -1) reloc.push_back(r.lc);
+            }
+            addWord(r.lc, w);
+        }
+        else if (r.cls == IC_DL && r.opcode == 1) {
+            ObjWord w; w.mem = r.mem;
+            addWord(r.lc, w);
+        }
+        else if (r.cls == IC_DL && r.opcode == 2 && r.mem > 0) {
+            ObjRecord rec; rec.kind = OBJ_BSS; rec.addr = r.lc; rec.count = r.mem;
+            recs.push_back(rec); words.emplace_back();
+        }
+    }
+    if (!withReloc) reloc.clear();
+    hdr.nrecords = (uint32_t)recs.size();
+    hdr.nreloc = (uint32_t)reloc.size();
+
+    ofstream out(path, ios::binary);
+    out.write((const char *)&hdr, sizeof hdr);
+    for (size_t i = 0; i < recs.size(); i++) {
+        out.write((const char *)&recs[i], sizeof(ObjRecord));
+        out.write((const char *)words[i].data(), words[i].size() * sizeof(ObjWord));
+    }
+    out.write((const char *)reloc.data(), reloc.size() * sizeof(int32_t));
+}
@@ -0,0 +1,50 @@
+// Phase statistics for pass1/pass2 -s (read by asm_bench.cpp).
+// Replaces the global operator new/delete to count allocations, so include it
+// from the one translation unit of a program only. Counting starts with the
+// first enabled PhaseStats; until then operator new is a plain malloc.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sys/resource.h>
+using namespace std;
+
+inline atomic<size_t> allocBytes{0};
+inline atomic<size_t> allocCount{0};
+inline bool countAllocs = false;    // set before any worker thread starts
+
+void *operator new(size_t n) {
+    if (countAllocs) {
+        allocBytes.fetch_add(n, memory_order_relaxed);
+        allocCount.fetch_add(1, memory_order_relaxed);
+    }
+    if (void *p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+// noinline keeps GCC from pairing the inlined free() with new-expressions
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { free(p); }
+
+// Prints one "STAT <phase> ..." line when stopped. Time and allocations cover
+// the phase only; process_peak_rss_kb is the whole process's peak so far
+// (getrusage has no per-phase figure), so it includes every earlier phase.
+struct PhaseStats {
+    const char *phase;
+    bool enabled;
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    size_t bytes0 = allocBytes.load(), count0 = allocCount.load();
+
+    PhaseStats(const char *phase, bool enabled) : phase(phase), enabled(enabled) { if (enabled) countAllocs = true; }
+
+    void stop(long lines) {
+        if (!enabled) return;
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        printf("STAT %s lines=%ld seconds=%.6f alloc_bytes=%zu allocs=%zu process_peak_rss_kb=%ld\n", phase, lines, secs,
+               allocBytes.load() - bytes0, allocCount.load() - count0, ru.ru_maxrss);
+        fflush(stdout);
+    }
+};
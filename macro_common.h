@@ -0,0 +1,622 @@
+// Macro processor pieces shared by pass1_macro and pass2_macro: header and
+// formal parsing, compiled macro bodies and the call expander.
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+inline string trim(const string &str) {
+    size_t first = str.find_first_not_of(" \t\r\n");
+    if (first == string::npos) return "";
+    size_t last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, (last - first + 1));
+}
+
+inline vector<string> split(const string &line, char delimiter = ',') {
+    vector<string> tokens;
+    stringstream ss(line);
+    string token;
+    while (getline(ss, token, delimiter)) {
+        tokens.push_back(trim(token));
+    }
+    return tokens;
+}
+
+// Call arguments: comma separated, or blank separated when there is no comma
+inline vector<string> splitArgs(const string &s) {
+    string t = trim(s);
+    vector<string> args;
+    if (t.empty()) return args;
+
+    bool hasComma = (t.find(',') != string::npos);
+    string token;
+    stringstream ss(t);
+
+    if (hasComma) {
+        while (getline(ss, token, ',')) {
+            token = trim(token);
+            if (!token.empty()) args.push_back(token);
+        }
+    } else {
+        while (ss >> token) args.push_back(token);
+    }
+    return args;
+}
+
+// All formal parameters of one macro in a trie, so a body line is rewritten
+// ("&param" -> "#idx") in a single left-to-right scan. The longest formal
+// wins, so &A and &AB do not clobber each other.
+struct FormalMatcher {
+    struct Node { unordered_map<char, int> next; int param = -1; };
+    vector<Node> nodes;
+
+    explicit FormalMatcher(const vector<string> &formals) : nodes(1) {
+        for (int i = 0; i < (int)formals.size(); ++i) {
+            int n = 0;
+            for (char c : formals[i]) {
+                auto it = nodes[n].next.find(c);
+                if (it == nodes[n].next.end()) {
+                    nodes[n].next[c] = (int)nodes.size();
+                    n = (int)nodes.size();
+                    nodes.emplace_back();
+                } else n = it->second;
+            }
+            if (nodes[n].param == -1) nodes[n].param = i;   // first of duplicate names wins
+        }
+    }
+
+    string rewrite(const string &line) const {
+        string out;
+        out.reserve(line.size());
+        size_t pos = 0;
+        while (pos < line.size()) {
+            if (line[pos] != '&') { out += line[pos++]; continue; }
+            // longest formal starting after '&'
+            int n = 0, param = -1;
+            size_t end = pos + 1, matchEnd = 0;
+            while (end < line.size()) {
+                auto it = nodes[n].next.find(line[end]);
+                if (it == nodes[n].next.end()) break;
+                n = it->second;
+                ++end;
+                if (nodes[n].param != -1) { param = nodes[n].param; matchEnd = end; }
+            }
+            if (param == -1) { out += line[pos++]; continue; }
+            out += '#';
+            out += to_string(param);
+            pos = matchEnd;
+        }
+        return out;
+    }
+};
+
+// parse macro header line: "MACNAME &A, &B, &REG=AREG"
+// formals are in header order, without &; keyword formals carry a default
+struct MacroHeader {
+    string name;
+    vector<string> formals;
+    vector<bool> keyword;
+    vector<string> defaults;    // "" for positional formals
+};
+
+inline MacroHeader parseMacroHeader(const string &headerLine) {
+    stringstream ss(headerLine);
+    MacroHeader h;
+    ss >> h.name;
+    string rest;
+    getline(ss, rest);
+    rest = trim(rest);
+    if (!rest.empty()) {
+        vector<string> parts = split(rest, ',');
+        for (string p : parts) {
+            p = trim(p);
+            // expect leading '&' — remove it
+            if (!p.empty() && p.front() == '&') p = p.substr(1);
+            if (p.empty()) continue;
+            size_t eq = p.find('=');
+            h.formals.push_back(trim(p.substr(0, eq)));
+            h.keyword.push_back(eq != string::npos);
+            h.defaults.push_back(eq != string::npos ? trim(p.substr(eq + 1)) : "");
+        }
+    }
+    return h;
+}
+
+// A macro body compiled once: each line is a run of pieces, either literal
+// text from `text` or a positional parameter slot (#n in mdt.txt)
+struct Piece { int param; int start; int len; };   // param >= 0: slot, else text[start, start+len)
+enum LineKind { LINE_TEXT, LINE_NONE, LINE_AIF, LINE_AGO };    // LINE_NONE: a lone sequencing symbol
+struct LineOp { LineKind kind; int target; };               // target: body line of the sequencing symbol, -1 if undefined
+struct KeywordParam { string name; int slot; string value; };
+struct CompiledMacro {
+    string text;
+    vector<Piece> pieces;
+    vector<int> lineEnd;    // lineEnd[k]: one past the last piece of body line k
+    vector<LineOp> ops;     // parallel to lineEnd
+    int formals = -1;       // -1: unknown, arguments bind by position only
+    vector<KeywordParam> keywords;
+};
+
+// "#n" takes all digits, so #1 and #10 are different slots. Nested
+// MACRO ... MEND blocks are part of the body; only the MEND that balances
+// them ends it. Sequencing symbols (".NAME" in the label field) are stripped
+// from the text and become AIF/AGO jump targets.
+inline CompiledMacro compileMacro(const vector<string> &MDT, int start) {
+    CompiledMacro m;
+    int depth = 0;
+    unordered_map<string, int> seq;
+    vector<string> jumps;   // target name per body line, "" for non-jumps
+    for (int i = start; i < (int)MDT.size(); i++) {
+        string body = trim(MDT[i]);
+        if (body == "MACRO") depth++;
+        else if (body == "MEND" && depth-- == 0) break;
+        LineOp op{LINE_TEXT, -1};
+        jumps.emplace_back();
+        if (depth == 0 && body.size() > 1 && body[0] == '.') {
+            size_t end = body.find_first_of(" \t");
+            seq.emplace(body.substr(0, end), (int)m.lineEnd.size());
+            body = end == string::npos ? "" : trim(body.substr(end));
+            if (body.empty()) op.kind = LINE_NONE;
+        }
+        if (depth == 0 && (body.compare(0, 4, "AIF ") == 0 || body.compare(0, 4, "AGO ") == 0)) {
+            op.kind = body[1] == 'I' ? LINE_AIF : LINE_AGO;
+            size_t dot = body.find_last_of(" \t)");
+            jumps.back() = trim(body.substr(dot + 1));
+        }
+        m.ops.push_back(op);
+        size_t pos = 0;
+        while (pos < body.size()) {
+            size_t hash = body.find('#', pos);
+            size_t digits = hash == string::npos ? hash : hash + 1;
+            while (digits != string::npos && digits < body.size() && isdigit((unsigned char)body[digits])) digits++;
+            // more than 9 digits cannot name a formal (and would overflow int): text
+            if (hash == string::npos || digits == hash + 1 || digits - hash - 1 > 9) {   // no placeholder left on this stretch
+                size_t to = hash == string::npos ? body.size() : hash + 1;
+                m.pieces.push_back({-1, (int)m.text.size(), (int)(to - pos)});
+                m.text.append(body, pos, to - pos);
+                pos = to;
+                continue;
+            }
+            if (hash > pos) {
+                m.pieces.push_back({-1, (int)m.text.size(), (int)(hash - pos)});
+                m.text.append(body, pos, hash - pos);
+            }
+            // keep the placeholder text too, for calls that pass fewer arguments
+            m.pieces.push_back({stoi(body.substr(hash + 1, digits - hash - 1)), (int)m.text.size(), (int)(digits - hash)});
+            m.text.append(body, hash, digits - hash);
+            pos = digits;
+        }
+        m.lineEnd.push_back((int)m.pieces.size());
+    }
+    for (size_t k = 0; k < jumps.size(); k++) {
+        auto it = jumps[k].empty() ? seq.end() : seq.find(jumps[k]);
+        if (it != seq.end()) m.ops[k].target = it->second;
+    }
+    return m;
+}
+
+// Record the formals of a header on a compiled body, so calls can bind
+// keyword arguments
+inline void setFormals(CompiledMacro &m, const MacroHeader &h) {
+    m.formals = (int)h.formals.size();
+    m.keywords.clear();
+    for (int i = 0; i < m.formals; i++)
+        if (h.keyword[i]) m.keywords.push_back({h.formals[i], i, h.defaults[i]});
+}
+
+// Map call arguments to slots: "NAME=value" sets a keyword formal, the rest
+// fill the positional formals in order. Keywords not given take their
+// default; positional formals not given keep their "#n" text.
+inline vector<string> bindArgs(const CompiledMacro &m, vector<string> actual) {
+    if (m.keywords.empty()) return actual;
+    vector<string> slots(m.formals);
+    vector<bool> isKeyword(m.formals, false);
+    for (const KeywordParam &k : m.keywords) { slots[k.slot] = k.value; isKeyword[k.slot] = true; }
+    int next = 0;
+    auto nextPositional = [&]() { while (next < m.formals && isKeyword[next]) next++; };
+    nextPositional();
+    for (string &a : actual) {
+        size_t eq = a.find('=');
+        if (eq != string::npos && eq > 0) {
+            string name = trim(a.substr(a[0] == '&' ? 1 : 0, eq - (a[0] == '&' ? 1 : 0)));
+            bool found = false;
+            for (const KeywordParam &k : m.keywords)
+                if (k.name == name) { slots[k.slot] = trim(a.substr(eq + 1)); found = true; break; }
+            if (found) continue;
+        }
+        if (next < m.formals) { slots[next++] = move(a); nextPositional(); }
+    }
+    for (; next < m.formals; next++, nextPositional())
+        if (!isKeyword[next]) slots[next] = "#" + to_string(next);
+    return slots;
+}
+
+// Append body line k of one call to line
+inline void expandLine(const CompiledMacro &m, size_t k, const vector<string> &args, string &line) {
+    for (int p = k ? m.lineEnd[k - 1] : 0; p < m.lineEnd[k]; p++) {
+        const Piece &pc = m.pieces[p];
+        if (pc.param >= 0 && pc.param < (int)args.size()) line += args[pc.param];
+        else line.append(m.text, pc.start, pc.len);
+    }
+}
+
+// "AIF (lhs REL rhs) .SEQ" with REL one of EQ NE LT LE GT GE; integers
+// compare by value, anything else as text. ok is cleared on a malformed test.
+inline bool evalCondition(const string &line, bool &ok) {
+    size_t open = line.find('('), close = line.rfind(')');
+    ok = false;
+    if (open == string::npos || close == string::npos || close < open) return false;
+    stringstream ss(line.substr(open + 1, close - open - 1));
+    string lhs, rel, rhs, extra;
+    if (!(ss >> lhs >> rel >> rhs) || (ss >> extra)) return false;
+    auto isInt = [](const string &s) {
+        size_t i = (s[0] == '-' || s[0] == '+') ? 1 : 0;
+        if (i == s.size() || s.size() - i > 18) return false;
+        for (; i < s.size(); i++) if (!isdigit((unsigned char)s[i])) return false;
+        return true;
+    };
+    int c;
+    if (isInt(lhs) && isInt(rhs)) { long long a = stoll(lhs), b = stoll(rhs); c = a < b ? -1 : a > b; }
+    else c = lhs.compare(rhs) < 0 ? -1 : lhs.compare(rhs) > 0;
+    ok = true;
+    if (rel == "EQ") return c == 0;
+    if (rel == "NE") return c != 0;
+    if (rel == "LT") return c < 0;
+    if (rel == "LE") return c <= 0;
+    if (rel == "GT") return c > 0;
+    if (rel == "GE") return c >= 0;
+    ok = false;
+    return false;
+}
+
+// --- Precompiled macro library (pass2_macro -w / -L) ---
+// One file used in place through mmap: a header, one LibMacro record per
+// macro, an open-addressing index of name hashes (record number + 1, 0 =
+// empty) and a data area with the names, compiled bodies and keyword
+// defaults. Opening it is one mmap; a macro is materialized on its first call.
+struct LibHeader { char magic[4]; uint32_t version, macros, slots, recordsOff, slotsOff, size; };
+struct LibMacro {
+    uint32_t nameOff, nameLen, textOff, textLen, piecesOff, pieces, linesOff, lines, opsOff, keywordsOff, keywords;
+    int32_t formals;
+};
+struct LibKeyword { uint32_t nameOff, nameLen, valueOff, valueLen; int32_t slot; };
+struct LibOp { int32_t kind, target; };
+static_assert(sizeof(Piece) == 12, "Piece is stored as three int32");
+
+inline uint32_t hashName(string_view s) {
+    uint32_t h = 2166136261u;
+    for (char c : s) h = (h ^ (unsigned char)c) * 16777619u;
+    return h;
+}
+
+// ms: name and body of every macro, names unique
+inline bool writeMacroLibrary(const string &path, const vector<pair<string, const CompiledMacro *>> &ms) {
+    uint32_t n = (uint32_t)ms.size(), slots = 16;
+    while (slots < 2 * n) slots *= 2;
+    uint32_t recordsOff = sizeof(LibHeader), slotsOff = recordsOff + n * sizeof(LibMacro);
+    uint32_t dataOff = slotsOff + slots * sizeof(uint32_t);
+    string data;
+    auto put = [&](const void *p, size_t len) {
+        uint32_t off = dataOff + (uint32_t)data.size();
+        data.append((const char *)p, len);
+        data.resize((data.size() + 3) & ~size_t(3));
+        return off;
+    };
+    vector<LibMacro> records(n);
+    vector<uint32_t> index(slots, 0);
+    for (uint32_t i = 0; i < n; i++) {
+        const string &name = ms[i].first;
+        const CompiledMacro &m = *ms[i].second;
+        LibMacro &r = records[i];
+        r.nameOff = put(name.data(), name.size()); r.nameLen = (uint32_t)name.size();
+        r.textOff = put(m.text.data(), m.text.size()); r.textLen = (uint32_t)m.text.size();
+        r.piecesOff = put(m.pieces.data(), m.pieces.size() * sizeof(Piece)); r.pieces = (uint32_t)m.pieces.size();
+        r.linesOff = put(m.lineEnd.data(), m.lineEnd.size() * sizeof(int)); r.lines = (uint32_t)m.lineEnd.size();
+        vector<LibOp> ops;
+        for (const LineOp &op : m.ops) ops.push_back({op.kind, op.target});
+        r.opsOff = put(ops.data(), ops.size() * sizeof(LibOp));
+        vector<LibKeyword> kws;
+        for (const KeywordParam &k : m.keywords)
+            kws.push_back({put(k.name.data(), k.name.size()), (uint32_t)k.name.size(),
+                           put(k.value.data(), k.value.size()), (uint32_t)k.value.size(), k.slot});
+        r.keywordsOff = put(kws.data(), kws.size() * sizeof(LibKeyword)); r.keywords = (uint32_t)kws.size();
+        r.formals = m.formals;
+        uint32_t s = hashName(name) & (slots - 1);
+        while (index[s]) s = (s + 1) & (slots - 1);
+        index[s] = i + 1;
+    }
+    LibHeader h{{'L', 'P', 'M', 'L'}, 1, n, slots, recordsOff, slotsOff, dataOff + (uint32_t)data.size()};
+    ofstream out(path, ios::binary);
+    out.write((const char *)&h, sizeof h);
+    out.write((const char *)records.data(), records.size() * sizeof(LibMacro));
+    out.write((const char *)index.data(), index.size() * sizeof(uint32_t));
+    out.write(data.data(), data.size());
+    return (bool)out;
+}
+
+struct MacroLibrary {
+    const char *base = nullptr;
+    size_t size = 0;
+    const LibHeader *hdr = nullptr;
+
+    MacroLibrary() = default;
+    MacroLibrary(const MacroLibrary &) = delete;
+    MacroLibrary &operator=(const MacroLibrary &) = delete;
+    ~MacroLibrary() { if (base) munmap((void *)base, size); }
+
+    bool fits(uint64_t off, uint64_t len) const { return off <= size && len <= size - off && off % 4 == 0; }
+
+    bool open(const string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(LibHeader)) {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) { base = (const char *)p; size = st.st_size; }
+        }
+        ::close(fd);
+        if (!base) return false;
+        hdr = (const LibHeader *)base;
+        return memcmp(hdr->magic, "LPML", 4) == 0 && hdr->version == 1 && hdr->size == size &&
+               hdr->slots && (hdr->slots & (hdr->slots - 1)) == 0 && hdr->macros < hdr->slots &&
+               fits(hdr->recordsOff, (uint64_t)hdr->macros * sizeof(LibMacro)) &&
+               fits(hdr->slotsOff, (uint64_t)hdr->slots * sizeof(uint32_t));
+    }
+
+    const LibMacro &record(uint32_t i) const { return ((const LibMacro *)(base + hdr->recordsOff))[i]; }
+
+    // Record number of name, or -1
+    int find(string_view name) const {
+        const uint32_t *index = (const uint32_t *)(base + hdr->slotsOff);
+        for (uint32_t s = hashName(name) & (hdr->slots - 1); index[s]; s = (s + 1) & (hdr->slots - 1)) {
+            uint32_t i = index[s] - 1;
+            if (i >= hdr->macros) return -1;
+            const LibMacro &r = record(i);
+            if (r.nameLen == name.size() && r.nameOff <= size && r.nameLen <= size - r.nameOff &&
+                memcmp(base + r.nameOff, name.data(), r.nameLen) == 0)
+                return (int)i;
+        }
+        return -1;
+    }
+
+    // false if the record points outside the file
+    bool load(int i, CompiledMacro &m) const {
+        const LibMacro &r = record(i);
+        if (r.textOff > size || r.textLen > size - r.textOff || !fits(r.piecesOff, (uint64_t)r.pieces * sizeof(Piece)) ||
+            !fits(r.linesOff, (uint64_t)r.lines * sizeof(int)) || !fits(r.opsOff, (uint64_t)r.lines * sizeof(LibOp)) ||
+            !fits(r.keywordsOff, (uint64_t)r.keywords * sizeof(LibKeyword)))
+            return false;
+        m = CompiledMacro();
+        m.text.assign(base + r.textOff, r.textLen);
+        const Piece *pieces = (const Piece *)(base + r.piecesOff);
+        m.pieces.assign(pieces, pieces + r.pieces);
+        const int *lines = (const int *)(base + r.linesOff);
+        m.lineEnd.assign(lines, lines + r.lines);
+        const LibOp *ops = (const LibOp *)(base + r.opsOff);
+        for (uint32_t k = 0; k < r.lines; k++) {
+            if (ops[k].kind < LINE_TEXT || ops[k].kind > LINE_AGO) return false;
+            m.ops.push_back({(LineKind)ops[k].kind, ops[k].target});
+        }
+        const LibKeyword *kws = (const LibKeyword *)(base + r.keywordsOff);
+        for (uint32_t k = 0; k < r.keywords; k++) {
+            const LibKeyword &kw = kws[k];
+            if (kw.nameOff > size || kw.nameLen > size - kw.nameOff || kw.valueOff > size || kw.valueLen > size - kw.valueOff) return false;
+            m.keywords.push_back({string(base + kw.nameOff, kw.nameLen), kw.slot, string(base + kw.valueOff, kw.valueLen)});
+        }
+        m.formals = r.formals;
+        // pieces, lines and jump targets must stay inside the body
+        for (const Piece &pc : m.pieces)
+            if (pc.start < 0 || pc.len < 0 || (size_t)pc.start + pc.len > m.text.size()) return false;
+        for (uint32_t k = 0; k < r.lines; k++)
+            if (m.lineEnd[k] < (k ? m.lineEnd[k - 1] : 0) || m.lineEnd[k] > (int)r.pieces ||
+                m.ops[k].target < -1 || m.ops[k].target >= (int)r.lines) return false;
+        for (const KeywordParam &kw : m.keywords)
+            if (kw.slot < 0 || kw.slot >= m.formals) return false;
+        return true;
+    }
+};
+
+// Expands source lines against a macro table. Calls inside expanded bodies
+// are expanded in turn on an explicit stack, and MACRO ... MEND blocks met
+// in the source or in an expansion define (or redefine) macros on the spot.
+// Finished expansions are memoized by (macro, label, arguments) until the
+// next definition changes the table. Names not defined so far are looked up
+// in the libraries, in order.
+struct MacroExpander {
+    deque<string> names;                // MNT keys point into these
+    unordered_map<string_view, int> MNT; // macro name -> index into macros
+    vector<shared_ptr<const CompiledMacro>> macros;
+    vector<const MacroLibrary *> libraries;
+    int maxDepth = 64;
+    long maxSteps = 100000;             // body lines one expansion may run through (AGO loops)
+    size_t memoLimit = 4096;            // entries kept before the memo is dropped
+    size_t memoBytes = 16 << 20;        // ...or bytes of keys and expansions
+    int errors = 0;
+    bool sawDefinition = false;         // a MACRO block was met while expanding
+    ostream *err = &cerr;
+
+    MacroExpander() = default;
+    // Same tables and settings, fresh expansion state
+    MacroExpander(const MacroExpander &o)
+        : macros(o.macros), libraries(o.libraries), maxDepth(o.maxDepth), maxSteps(o.maxSteps), memoLimit(o.memoLimit),
+          memoBytes(o.memoBytes) {
+        for (const string &name : o.names) MNT[names.emplace_back(name)] = o.MNT.at(name);
+    }
+    MacroExpander &operator=(const MacroExpander &) = delete;
+
+    struct Frame {
+        int macro;
+        shared_ptr<const CompiledMacro> body;   // stays valid if the macro is redefined meanwhile
+        vector<string> args;
+        string label;
+        size_t line = 0;                // next body line to produce
+        size_t outStart;                // where this expansion starts in out
+        long steps = 0;
+        bool labelled = false;          // label already put on a generated line
+        bool memoOK = true;
+        string key;
+    };
+    vector<Frame> frames;
+    unordered_map<string, string> memo;
+    size_t memoUsed = 0;                // bytes held by memo
+    vector<string> defLines;            // MACRO block being collected
+    int defDepth = -1;                  // -1: not collecting
+
+    int add(string_view name, CompiledMacro m) {
+        names.emplace_back(name);
+        macros.push_back(make_shared<const CompiledMacro>(move(m)));
+        return MNT[names.back()] = (int)macros.size() - 1;
+    }
+
+    void define(const string &name, const CompiledMacro &m) {
+        auto it = MNT.find(name);
+        if (it != MNT.end()) macros[it->second] = make_shared<const CompiledMacro>(m);
+        else add(name, m);
+        clearMemo();
+        for (Frame &f : frames) f.memoOK = false;   // replaying them would skip the definition
+    }
+
+    void clearMemo() { memo.clear(); memoUsed = 0; }
+
+    // Memoize out[from..] under key; an expansion too big to pay off
+    // (over a quarter of the byte cap) is not kept
+    void remember(const string &key, const string &out, size_t from) {
+        size_t bytes = key.size() + out.size() - from;
+        if (bytes > memoBytes / 4 || memo.count(key)) return;
+        if (memo.size() >= memoLimit || memoUsed + bytes > memoBytes) clearMemo();
+        memo.emplace(key, out.substr(from));
+        memoUsed += bytes;
+    }
+
+    // Expand one source line (and everything it calls) onto out
+    void expand(const string &raw, string &out) {
+        handle(raw, out);
+        while (!frames.empty()) {
+            Frame &f = frames.back();
+            const CompiledMacro &m = *f.body;
+            if (f.line == m.lineEnd.size()) {
+                if (f.memoOK) remember(f.key, out, f.outStart);
+                frames.pop_back();
+                continue;
+            }
+            if (++f.steps > maxSteps) {
+                fail("expansion runs past " + to_string(maxSteps) + " lines (AGO loop?)");
+                f.line = m.lineEnd.size();
+                continue;
+            }
+            size_t k = f.line++;
+            LineOp op = m.ops[k];
+            if (op.kind == LINE_NONE) continue;
+            string text;
+            if (op.kind == LINE_TEXT && !f.labelled && !f.label.empty()) { text += f.label; text += ' '; f.labelled = true; }
+            expandLine(m, k, f.args, text);
+            if (op.kind == LINE_TEXT) { handle(text, out); continue; }
+            bool ok = true, jump = op.kind == LINE_AGO || evalCondition(text, ok);
+            if (!ok) fail("bad condition: " + text);
+            if (jump && op.target < 0) { fail("undefined sequencing symbol: " + text); f.line = m.lineEnd.size(); }
+            else if (jump) f.line = op.target;
+        }
+    }
+
+    // Index into macros, -1 if name is no macro
+    int lookup(string_view name) {
+        auto it = MNT.find(name);
+        if (it != MNT.end()) return it->second;
+        for (const MacroLibrary *lib : libraries) {
+            int i = lib->find(name);
+            if (i < 0) continue;
+            CompiledMacro m;
+            if (lib->load(i, m)) return add(name, move(m));
+            fail("corrupt macro library entry: " + string(name));
+            return -1;
+        }
+        return -1;
+    }
+
+private:
+    void fail(const string &msg) {
+        *err << "Error: " << msg << "\n";
+        errors++;
+        for (Frame &f : frames) f.memoOK = false;
+    }
+
+    void handle(const string &raw, string &out) {
+        string s = trim(raw);
+        if (defDepth >= 0) { collect(s); return; }
+        if (s.empty()) { out += '\n'; return; }
+        if (s == "MACRO") { defDepth = 0; defLines.clear(); sawDefinition = true; return; }
+
+        // label or name, name, and where the arguments start
+        string_view tok[2];
+        size_t after[2] = {0, 0}, pos = 0;
+        int ntok = 0;
+        while (ntok < 2) {
+            while (pos < s.size() && isspace((unsigned char)s[pos])) pos++;
+            if (pos == s.size()) break;
+            size_t start = pos;
+            while (pos < s.size() && !isspace((unsigned char)s[pos])) pos++;
+            tok[ntok] = string_view(s).substr(start, pos - start);
+            after[ntok++] = pos;
+        }
+
+        int id = -1, nameTok = 1;
+        if (ntok > 1) id = lookup(tok[1]);
+        if (id < 0 && tok[0].back() != ':') { nameTok = 0; id = lookup(tok[0]); }
+        if (id < 0) {
+            out += raw;
+            out += '\n';
+            return;
+        }
+        if ((int)frames.size() >= maxDepth) {
+            fail("macro nesting deeper than " + to_string(maxDepth) + " at: " + s);
+            out += raw;
+            out += '\n';
+            return;
+        }
+
+        Frame f;
+        f.macro = id;
+        f.body = macros[id];
+        f.args = bindArgs(*f.body, splitArgs(s.substr(after[nameTok])));
+        if (nameTok == 1) f.label = string(tok[0]);
+        f.outStart = out.size();
+        f.key = to_string(f.macro) + '\x1f' + f.label;
+        for (const string &a : f.args) { f.key += '\x1f'; f.key += a; }
+        auto hit = memo.find(f.key);
+        if (hit != memo.end()) { out += hit->second; return; }
+        frames.push_back(move(f));
+    }
+
+    // Body lines of a definition met during expansion, up to the MEND that
+    // balances its MACRO
+    void collect(const string &s) {
+        if (s == "MACRO") defDepth++;
+        else if (s == "MEND" && defDepth-- == 0) {
+            if (defLines.empty()) return;
+            MacroHeader h = parseMacroHeader(defLines[0]);
+            FormalMatcher fm(h.formals);
+            vector<string> body;
+            for (size_t i = 1; i < defLines.size(); i++) body.push_back(fm.rewrite(defLines[i]));
+            body.push_back("MEND");
+            CompiledMacro m = compileMacro(body, 0);
+            setFormals(m, h);
+            define(h.name, m);
+            return;
+        }
+        if (!s.empty()) defLines.push_back(s);
+    }
+};
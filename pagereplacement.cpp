@@ -3,6 +3,10 @@
 #include <queue>
 #include <unordered_set>
 #include <unordered_map>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <cstdlib>
 
 using namespace std;
 
@@ -26,7 +30,7 @@ int fifo(const vector<int>& pages, int frames) {
     return faults;
 }
 
-// LRU using a vector (linear-time per access)
+// LRU using a vector (linear-time per access); kept as the reference for lru_list
 int lru_vector(const vector<int>& pages, int frames) {
     if (frames <= 0) return pages.size();
     vector<int> recent; // front = most recent, back = least recent
@@ -57,6 +61,125 @@ int lru_vector(const vector<int>& pages, int frames) {
     return faults;
 }
 
+// Page -> pool slot for LruList: a hash map for any page numbers...
+struct HashIndex {
+    unordered_map<int, int> slot;
+    explicit HashIndex(size_t expect) { slot.reserve(expect); }
+    int find(int page) const { auto it = slot.find(page); return it == slot.end() ? -1 : it->second; }
+    void set(int page, int s) { slot[page] = s; }
+    void erase(int page) { slot.erase(page); }
+};
+
+// ...or a flat array for dense ones in [0, maxPage]
+struct FlatIndex {
+    vector<int> slot;
+    explicit FlatIndex(int maxPage) : slot(maxPage + 1, -1) {}
+    int find(int page) const { return slot[page]; }
+    void set(int page, int s) { slot[page] = s; }
+    void erase(int page) { slot[page] = -1; }
+};
+
+// LRU in O(1) per access: one node per frame, allocated once from a pool and
+// linked from most to least recent. A hit moves its node to the head, a fault
+// takes a fresh node or, once all frames are full, reuses the tail's.
+template <class Index>
+class LruList {
+    struct Node { int page, prev, next; };
+    vector<Node> pool;
+    int frames, head = -1, tail = -1;
+    Index index;
+
+    void unlink(int s) {
+        Node &n = pool[s];
+        (n.prev == -1 ? head : pool[n.prev].next) = n.next;
+        (n.next == -1 ? tail : pool[n.next].prev) = n.prev;
+    }
+    void pushFront(int s) {
+        pool[s].prev = -1;
+        pool[s].next = head;
+        (head == -1 ? tail : pool[head].prev) = s;
+        head = s;
+    }
+
+public:
+    // expect: frames likely to be used, at most the trace length
+    LruList(int frames, Index index, size_t expect) : frames(frames), index(move(index)) { pool.reserve(expect); }
+
+    // Reference page; true on a hit
+    bool access(int page) {
+        int s = index.find(page);
+        if (s != -1) {
+            if (s != head) { unlink(s); pushFront(s); }
+            return true;
+        }
+        if ((int)pool.size() < frames) {
+            s = pool.size();
+            pool.push_back({page, -1, -1});
+        } else {
+            s = tail;
+            index.erase(pool[s].page);
+            unlink(s);
+            pool[s].page = page;
+        }
+        index.set(page, s);
+        pushFront(s);
+        return false;
+    }
+};
+
+// Memory follows the trace, not the frame count: a trace touches at most
+// pages.size() frames
+inline size_t framesUsed(const vector<int>& pages, int frames) { return min<size_t>(frames, pages.size()); }
+
+template <class Index>
+int lruFaults(const vector<int>& pages, int frames, Index index) {
+    LruList<Index> lru(frames, move(index), framesUsed(pages, frames));
+    int faults = 0;
+    for (int p : pages) faults += !lru.access(p);
+    return faults;
+}
+
+enum LruIndex { LRU_AUTO, LRU_HASH, LRU_FLAT };
+
+// LRU with the list. LRU_AUTO takes the flat index when page numbers are
+// non-negative and not much larger than the trace, else the hash map;
+// LRU_FLAT falls back to the hash map for negative page numbers.
+int lru_list(const vector<int>& pages, int frames, LruIndex which = LRU_AUTO) {
+    if (frames <= 0) return pages.size();
+    if (pages.empty()) return 0;
+    auto [lo, hi] = minmax_element(pages.begin(), pages.end());
+    bool flat = which == LRU_FLAT ? *lo >= 0
+              : which == LRU_AUTO && *lo >= 0 && *hi <= max<long long>(1 << 20, 4LL * pages.size());
+    if (flat) return lruFaults(pages, frames, FlatIndex(*hi));
+    return lruFaults(pages, frames, HashIndex(framesUsed(pages, frames)));
+}
+
+// Differential check of lru_list (both indexes) against lru_vector on random
+// traces: small, dense, sparse and negative page numbers, frames from 0 to
+// past the working set. Returns the number of mismatches.
+int checkLru(int trials, unsigned seed) {
+    mt19937 rng(seed);
+    int bad = 0;
+    for (int t = 0; t < trials; ++t) {
+        int n = rng() % 400, frames = rng() % 40, range = 1 + rng() % 60;
+        bool negative = rng() % 4 == 0, sparse = rng() % 4 == 0;
+        vector<int> pages(n);
+        for (int &p : pages) {
+            p = rng() % range;
+            if (negative) p -= range / 2;
+            if (sparse) p *= 1009;
+        }
+        int want = lru_vector(pages, frames);
+        int hash = lru_list(pages, frames, LRU_HASH), flat = lru_list(pages, frames, LRU_FLAT);
+        if (hash != want || flat != want) {
+            if (++bad <= 5)
+                cerr << "LRU mismatch: trial " << t << ", frames " << frames << ", pages " << n
+                     << ": vector " << want << ", hash " << hash << ", flat " << flat << '\n';
+        }
+    }
+    return bad;
+}
+
 // Optimal page faults (unchanged)
 int optimal(const vector<int>& pages, int frames) {
     if (frames <= 0) return pages.size();
@@ -84,10 +207,29 @@ int optimal(const vector<int>& pages, int frames) {
     return faults;
 }
 
-int main() {
+// Usage: pagereplacement [-i auto|hash|flat] | pagereplacement --check [TRIALS]
+//   -i       page index of the list LRU (default auto)
+//   --check  compare lru_list with both indexes against lru_vector on
+//            TRIALS random traces (default 20000); exit status 1 on a mismatch
+int main(int argc, char *argv[]) {
     ios::sync_with_stdio(false);
     cin.tie(nullptr);
 
+    LruIndex which = LRU_AUTO;
+    string a = argc > 1 ? argv[1] : "";
+    if (a == "--check" && argc <= 3) {
+        int trials = argc == 3 ? atoi(argv[2]) : 20000;
+        int bad = checkLru(trials, 12345);
+        cout << "LRU check: " << bad << " mismatch(es) in " << trials << " traces\n";
+        return bad ? 1 : 0;
+    }
+    if (a == "-i" && argc == 3 && string(argv[2]) == "hash") which = LRU_HASH;
+    else if (a == "-i" && argc == 3 && string(argv[2]) == "flat") which = LRU_FLAT;
+    else if (argc != 1 && !(a == "-i" && argc == 3 && string(argv[2]) == "auto")) {
+        cerr << "Usage: pagereplacement [-i auto|hash|flat] | pagereplacement --check [TRIALS]\n";
+        return 1;
+    }
+
     int frames;
     cout << "Enter number of frames: ";
     if (!(cin >> frames) || frames < 0) { cerr << "Invalid frame count.\n"; return 1; }
@@ -102,7 +244,15 @@ int main() {
 
     cout << "\nPage Faults:\n";
     cout << "FIFO:     " << fifo(pages, frames) << '\n';
-    cout << "LRU(vec): " << lru_vector(pages, frames) << '\n';
+    int lru = lru_list(pages, frames, which);
+    cout << "LRU:      " << lru << '\n';
+    // the vector version is the reference, too slow for big configurations
+    if ((long long)framesUsed(pages, frames) * n <= 100000000) {
+        int ref = lru_vector(pages, frames);
+        cout << "LRU(vec): " << ref << '\n';
+        if (ref != lru) { cerr << "LRU mismatch against the vector version\n"; return 1; }
+    }
+    else cout << "LRU(vec): skipped (frames x pages > 1e8)\n";
     cout << "Optimal:  " << optimal(pages, frames) << '\n';
 
     return 0;
@@ -1,42 +1,38 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
 #include <iomanip>
+#include <charconv>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "asm_common.h"
+#include "asm_stats.h"
+#include "macro_common.h"
 using namespace std;
 
-// --- Global Data Structures (Unchanged) ---
-map<string, pair<string, int>> MOT = {
-    {"STOP", {"IS", 0}}, {"ADD", {"IS", 1}}, {"SUB", {"IS", 2}},
-    {"MULT", {"IS", 3}}, {"MOVER", {"IS", 4}}, {"MOVEM", {"IS", 5}},
-    {"COMP", {"IS", 6}}, {"BC", {"IS", 7}}, {"DIV", {"IS", 8}},
-    {"READ", {"IS", 9}}, {"PRINT", {"IS", 10}}
-};
-map<string, pair<string, int>> AD = {
-    {"START", {"AD", 1}}, {"END", {"AD", 2}},
-    {"ORIGIN", {"AD", 3}}, {"EQU", {"AD", 4}}, {"LTORG", {"AD", 5}}
-};
-map<string, pair<string, int>> DL = { {"DC", {"DL", 1}}, {"DS", {"DL", 2}} };
-map<string, int> REG = { {"AREG", 1}, {"BREG", 2}, {"CREG", 3}, {"DREG", 4} };
-map<string, int> CC  = { {"LT", 1}, {"LE", 2}, {"EQ", 3}, {"GT", 4}, {"GE", 5}, {"ANY", 6} };
+// --- Global Data Structures ---
+// Opcode tables: see MNEMONICS / classifyMnemonic in asm_common.h
 
-struct Symbol { string name; int addr; bool defined = false; };
+// relocatable is false for symbols EQU'd to a plain number; extBase is set for
+// SYMBOL+-n on a symbol undefined at the EQU (its symtab position; n is extOff),
+// which the linker resolves against other modules if the module never defines it
+struct Symbol { string name; int addr; bool defined = false; bool relocatable = true; int extBase = -1; int extOff = 0; };
 struct Literal { string lit; int addr; };
 
-vector<Symbol> symtab;
-vector<Literal> littab;
-vector<int> pooltab;
-
-int LC = 0;
-int literalPoolStart = 0;
-
-// --- Small helpers (just 3) ---
-int searchSymbol(string s){ for(int i=0;i<(int)symtab.size();++i) if(symtab[i].name==s) return i; return -1; }
-int searchLiteral(string s){ for(int i=0;i<(int)littab.size();++i) if(littab[i].lit==s) return i; return -1; }
-
-bool isNumber(const string& s){
+// --- Small helpers ---
+bool isNumber(string_view s){
     if(s.empty()) return false;
     int i = (s[0]=='+'||s[0]=='-')?1:0;
     if(i==(int)s.size()) return false;
@@ -44,161 +40,609 @@ bool isNumber(const string& s){
     return true;
 }
 
-// number | SYMBOL | SYMBOL+number | SYMBOL-number
-int evalExpr(const string& e){
-    if(isNumber(e)) return stoi(e);
-    size_t p = e.find_first_of("+-");
-    if(p==string::npos){ // plain symbol
-        int si = searchSymbol(e);
-        if(si==-1){ symtab.push_back({e,-1,false}); return 0; }
-        return symtab[si].addr;
-    }
-    string left = e.substr(0,p), right = e.substr(p+1);
-    int base = 0, si = searchSymbol(left);
-    if(si==-1) symtab.push_back({left,-1,false});
-    else base = symtab[si].addr;
-    int off = isNumber(right)? stoi(right) : 0;
-    return (e[p]=='+') ? base+off : base-off;
+// stoi for a token already checked with isNumber
+int toInt(string_view s){
+    int v = 0;
+    if(!s.empty() && s[0]=='+') s.remove_prefix(1);
+    from_chars(s.data(), s.data()+s.size(), v);
+    return v;
 }
 
 // DC operand: handles numbers and quoted chars/strings like '9' or "A"
-int parseDC(const string& t){
-    if(isNumber(t)) return stoi(t);
+int parseDC(string_view t){
+    if(isNumber(t)) return toInt(t);
     if(t.size()>=2 && ((t.front()=='\''&&t.back()=='\'')||(t.front()=='"'&&t.back()=='"'))){
-        string mid = t.substr(1, t.size()-2);
-        if(isNumber(mid)) return stoi(mid);
+        string_view mid = t.substr(1, t.size()-2);
+        if(isNumber(mid)) return toInt(mid);
         return mid.empty()?0:(int)mid[0];
     }
     return 0;
 }
 
-// Process pending literals
-void processLiterals(ofstream &icFile) {
-    if ((int)littab.size() > literalPoolStart) pooltab.push_back(literalPoolStart + 1);
-    for (int i = literalPoolStart; i < (int)littab.size(); i++) {
-        if (littab[i].addr == -1) {
-            icFile << LC << " (DL,01) (C," << littab[i].lit.substr(2, littab[i].lit.length() - 3) << ")\n";
-            littab[i].addr = LC;
-            LC++;
-        }
-    }
-    literalPoolStart = (int)littab.size();
+ICRecord makeIC(int lc, ICClass cls, int opcode, ICOperand memKind = OP_NONE, int mem = 0){
+    ICRecord r; r.lc = lc; r.cls = cls; r.opcode = (uint8_t)opcode; r.memKind = memKind; r.mem = mem;
+    return r;
 }
 
-// Core
-void processLine(vector<string> tokens, ofstream &icFile) {
-    if (tokens.empty()) return;
+// All state of one module's Pass 1, so several modules can be assembled at once
+struct Assembler {
+    string name;                // module name for diagnostics ("" for the single-module run)
+
+    // deques: entries never move, so the index keys below can view their names
+    deque<Symbol> symtab;
+    deque<Literal> littab;
+    vector<int> pooltab;
+    vector<ICRecord> ic;        // intermediate code, dumped as text and optionally as binary
+
+    // name -> position in symtab/littab; positions follow insertion order, which (S,n)/(L,n) use
+    unordered_map<string_view, int> symIndex;
+    unordered_map<string_view, int> litIndex;
 
-    if (tokens[0] == "START") {
-        LC = stoi(tokens[1]);                 // input uses plain number
-        icFile << LC << " (AD,01) (C," << tokens[1] << ")\n";
-        return;
+    int LC = 0;
+    int startLC = 0;            // operand of START
+    int endLC = 0;              // highest location used, one past the last word
+    int literalPoolStart = 0;
+
+    // One-pass mode (-1): machine code is produced as each line is processed.
+    // A use of an undefined symbol or unplaced literal is chained through the
+    // mem fields of the waiting words (head per table entry, -1 ends the chain)
+    // and backpatched when the address is assigned, or at the end of input.
+    bool onePass = false;
+    vector<MachineWord> code;
+    vector<int> symFixup;
+    vector<int> litFixup;
+
+    int searchSymbol(string_view s){ auto it = symIndex.find(s); return it==symIndex.end() ? -1 : it->second; }
+    int searchLiteral(string_view s){ auto it = litIndex.find(s); return it==litIndex.end() ? -1 : it->second; }
+    int addSymbol(string_view s, int addr){
+        symtab.push_back({string(s),addr,false}); symFixup.push_back(-1);
+        return symIndex[symtab.back().name] = (int)symtab.size()-1;
+    }
+    int addLiteral(string_view s){
+        littab.push_back({string(s),-1}); litFixup.push_back(-1);
+        return litIndex[littab.back().lit] = (int)littab.size()-1;
     }
 
-    int idx = 0;
-    string potentialLabel = tokens[0];
-    if (MOT.count(potentialLabel)==0 && DL.count(potentialLabel)==0 && AD.count(potentialLabel)==0) {
-        int pos = searchSymbol(potentialLabel);
-        if (pos == -1) { symtab.push_back({potentialLabel, LC, false}); pos = (int)symtab.size() - 1; }
-        if (symtab[pos].defined) cerr << "Error: Duplicate label definition: " << potentialLabel << endl;
-        else { symtab[pos].addr = LC; symtab[pos].defined = true; }
-        idx = 1;
+    // Patch every word on the chain starting at head with addr
+    void backpatch(int &head, int addr){
+        for (int at = head; at != -1; ) { int next = code[at].mem; code[at].mem = addr; at = next; }
+        head = -1;
     }
-    if ((int)tokens.size() <= idx) return;
 
-    string op = tokens[idx];
+    void setSymbolAddr(int pos, int addr){ symtab[pos].addr = addr; backpatch(symFixup[pos], addr); }
+    void setLiteralAddr(int pos, int addr){ littab[pos].addr = addr; backpatch(litFixup[pos], addr); }
 
-    if (AD.count(op)) {
-        if (op == "END") {
-            processLiterals(icFile);
-            icFile << "(AD,02)\n";
+    // number | SYMBOL | SYMBOL+number | SYMBOL-number
+    int evalExpr(string_view e){
+        if(isNumber(e)) return toInt(e);
+        size_t p = e.find_first_of("+-");
+        if(p==string::npos){ // plain symbol
+            int si = searchSymbol(e);
+            if(si==-1){ addSymbol(e,-1); return 0; }
+            return symtab[si].addr;
         }
-        else if (op == "LTORG") {
-            icFile << "(AD,05)\n";
-            processLiterals(icFile);
+        string_view left = e.substr(0,p), right = e.substr(p+1);
+        int base = 0, si = searchSymbol(left);
+        if(si==-1) addSymbol(left,-1);
+        else base = symtab[si].addr;
+        int off = isNumber(right)? toInt(right) : 0;
+        return (e[p]=='+') ? base+off : base-off;
+    }
+
+    // Two-pass: queue the IC record. One-pass: turn it into machine code now.
+    void emit(const ICRecord &r){
+        if (r.cls == IC_IS || (r.cls == IC_DL && r.opcode == 1)) endLC = max(endLC, r.lc + 1);
+        else if (r.cls == IC_DL) endLC = max(endLC, r.lc + r.mem);
+        if (!onePass) { ic.push_back(r); return; }
+        if (r.cls == IC_IS) {
+            MachineWord w; w.opcode = r.opcode; w.reg = r.regKind != OP_NONE ? r.reg : 0;
+            if (r.memKind == OP_S) {
+                int pos = r.mem - 1;
+                if (symtab[pos].defined) w.mem = symtab[pos].addr;
+                else { w.mem = symFixup[pos]; symFixup[pos] = (int)code.size(); }
+            } else if (r.memKind == OP_L) {
+                int pos = r.mem - 1;
+                if (littab[pos].addr != -1) w.mem = littab[pos].addr;
+                else { w.mem = litFixup[pos]; litFixup[pos] = (int)code.size(); }
+            }
+            code.push_back(w);
         }
-        else if (op == "ORIGIN") {             // changed: evalExpr
-            int v = evalExpr(tokens[idx+1]);
-            icFile << "(AD,03) (C," << v << ")\n";
-            LC = v;
+        else if (r.cls == IC_DL) {
+            MachineWord w;
+            if (r.opcode == 1) w.mem = r.mem; else w.repeat = r.mem;
+            code.push_back(w);
         }
-        else if (op == "EQU") {                // changed: evalExpr
-            int symPos = searchSymbol(tokens[idx-1]);
-            if (symPos != -1) {
-                int v = evalExpr(tokens[idx+1]);
-                symtab[symPos].addr = v;
-                icFile << "(AD,04) (C," << v << ")\n";
+    }
+
+    // Process pending literals
+    void processLiterals() {
+        if ((int)littab.size() > literalPoolStart) pooltab.push_back(literalPoolStart + 1);
+        for (int i = literalPoolStart; i < (int)littab.size(); i++) {
+            if (littab[i].addr == -1) {
+                emit(makeIC(LC, IC_DL, 1, OP_C, parseDC(string_view(littab[i].lit).substr(1))));
+                setLiteralAddr(i, LC);
+                LC++;
             }
         }
-        return;
+        literalPoolStart = (int)littab.size();
     }
 
-    int currentLC = LC;
+    // Core
+    void processLine(const vector<string_view> &tokens) {
+        if (tokens.empty()) return;
 
-    if (MOT.count(op)) {
-        icFile << currentLC << " (IS," << setw(2) << setfill('0') << MOT[op].second << ") ";
-        for (int i = idx + 1; i < (int)tokens.size(); i++) {
-            if (REG.count(tokens[i])) icFile << "(R," << REG[tokens[i]] << ") ";
-            else if (CC.count(tokens[i])) icFile << "(CC," << CC[tokens[i]] << ") ";
-            else if (tokens[i][0] == '=') {
-                int litIndex = searchLiteral(tokens[i]);
-                if (litIndex == -1) { littab.push_back({tokens[i], -1}); litIndex = (int)littab.size() - 1; }
-                icFile << "(L," << litIndex + 1 << ") ";
-            } else {
-                int pos = searchSymbol(tokens[i]);
-                if (pos == -1) { symtab.push_back({tokens[i], -1, false}); pos = (int)symtab.size() - 1; }
-                icFile << "(S," << pos + 1 << ") ";
+        if (tokens[0] == "START") {
+            LC = startLC = endLC = toInt(tokens[1]);   // input uses plain number
+            emit(makeIC(LC, IC_AD, 1, OP_C, LC));
+            return;
+        }
+
+        int idx = 0;
+        string_view potentialLabel = tokens[0];
+        MnemonicKind first = classifyMnemonic(potentialLabel).kind;
+        if (first != MN_IS && first != MN_AD && first != MN_DL) {
+            int pos = searchSymbol(potentialLabel);
+            if (pos == -1) pos = addSymbol(potentialLabel, LC);
+            if (symtab[pos].defined)
+                cerr << "Error: " << (name.empty() ? "" : name + ": ") << "Duplicate label definition: " << potentialLabel << endl;
+            else {
+                // an EQU label gets its value (and its fixups patched) by the EQU below
+                if (tokens.size() > 1 && tokens[1] == "EQU") symtab[pos].addr = LC;
+                else setSymbolAddr(pos, LC);
+                symtab[pos].defined = true;
             }
+            idx = 1;
         }
-        icFile << "\n";
-        LC++;
-    }
-    else if (DL.count(op)) {
-        if (op == "DS") {
-            int size = stoi(tokens[idx + 1]);          // input uses plain number
-            icFile << currentLC << " (DL,02) (C," << size << ")\n";
-            LC += size;
+        if ((int)tokens.size() <= idx) return;
+
+        string_view op = tokens[idx];
+        Mnemonic mn = classifyMnemonic(op);
+
+        if (mn.kind == MN_AD) {
+            if (op == "END") {
+                processLiterals();
+                emit(makeIC(-1, IC_AD, 2));
+            }
+            else if (op == "LTORG") {
+                emit(makeIC(-1, IC_AD, 5));
+                processLiterals();
+            }
+            else if (op == "ORIGIN") {             // changed: evalExpr
+                int v = evalExpr(tokens[idx+1]);
+                emit(makeIC(-1, IC_AD, 3, OP_C, v));
+                LC = v;
+            }
+            else if (op == "EQU") {                // changed: evalExpr
+                int symPos = searchSymbol(tokens[idx-1]);
+                if (symPos != -1) {
+                    int v = evalExpr(tokens[idx+1]);
+                    setSymbolAddr(symPos, v);
+                    // a number is absolute; a symbol passes on its own kind,
+                    // including an EQU chain that ends at an undefined symbol
+                    string_view e = tokens[idx+1];
+                    size_t p = e.find_first_of("+-");
+                    int base = isNumber(e) ? -1 : searchSymbol(e.substr(0, p));
+                    Symbol &sym = symtab[symPos];
+                    sym.relocatable = base != -1 && (!symtab[base].defined || symtab[base].relocatable);
+                    int off = p == string_view::npos || !isNumber(e.substr(p + 1)) ? 0 : toInt(e.substr(p + 1));
+                    if (p != string_view::npos && e[p] == '-') off = -off;
+                    if (base != -1 && !symtab[base].defined) { sym.extBase = base; sym.extOff = off; }
+                    else if (base != -1 && symtab[base].extBase != -1) {
+                        sym.extBase = symtab[base].extBase;
+                        sym.extOff = symtab[base].extOff + off;
+                    }
+                    emit(makeIC(-1, IC_AD, 4, OP_C, v));
+                }
+            }
+            return;
         }
-        else if (op == "DC") {                          // changed: parseDC
-            int val = parseDC(tokens[idx + 1]);
-            icFile << currentLC << " (DL,01) (C," << val << ")\n";
+
+        int currentLC = LC;
+
+        if (mn.kind == MN_IS) {
+            ICRecord r = makeIC(currentLC, IC_IS, mn.code);
+            for (int i = idx + 1; i < (int)tokens.size(); i++) {
+                if (tokens[i].empty()) continue;   // a lone ',' (e.g. "AREG, , X")
+                Mnemonic operand = classifyMnemonic(tokens[i]);
+                if (operand.kind == MN_REG) { r.regKind = OP_R; r.reg = operand.code; }
+                else if (operand.kind == MN_CC) { r.regKind = OP_CC; r.reg = operand.code; }
+                else if (tokens[i][0] == '=') {
+                    int lit = searchLiteral(tokens[i]);
+                    if (lit == -1) lit = addLiteral(tokens[i]);
+                    r.memKind = OP_L; r.mem = lit + 1;
+                } else {
+                    int pos = searchSymbol(tokens[i]);
+                    if (pos == -1) pos = addSymbol(tokens[i], -1);
+                    r.memKind = OP_S; r.mem = pos + 1;
+                }
+            }
+            emit(r);
             LC++;
         }
+        else if (mn.kind == MN_DL) {
+            if (op == "DS") {
+                int size = toInt(tokens[idx + 1]);         // input uses plain number
+                emit(makeIC(currentLC, IC_DL, 2, OP_C, size));
+                LC += size;
+            }
+            else if (op == "DC") {                          // changed: parseDC
+                int val = parseDC(tokens[idx + 1]);
+                emit(makeIC(currentLC, IC_DL, 1, OP_C, val));
+                LC++;
+            }
+        }
     }
-}
 
-int main() {
-    ifstream inFile("input.txt");
-    ofstream icFile("intermediate.txt");
-    ofstream symFile("symtab.txt");
-    ofstream litFile("littab.txt");
-    ofstream poolFile("pooltab.txt");
+    void assemble(const char *p, const char *end);
 
-    if (!inFile) { cerr << "Error: input.txt not found!\n"; return 1; }
+    // After the last line: open the final literal pool, settle remaining fixups
+    void finish() {
+        if ((int)littab.size() > literalPoolStart) pooltab.push_back(literalPoolStart + 1);
+        if (onePass) {   // still-undefined symbols and literals without a pool keep their -1
+            for (int i = 0; i < (int)symtab.size(); i++) backpatch(symFixup[i], symtab[i].addr);
+            for (int i = 0; i < (int)littab.size(); i++) backpatch(litFixup[i], littab[i].addr);
+        }
+    }
+
+    void writeTables(bool binaryIC);
+};
+
+// input.txt mapped read-only (read into memory if it cannot be mapped)
+struct SourceBuffer {
+    const char *data = nullptr;
+    size_t size = 0;
+    void *mapped = nullptr;
+    string copy;
 
-    string line;
-    while (getline(inFile, line)) {
-        stringstream ss(line);
-        vector<string> tokens; string word;
-        while (ss >> word) { if (!word.empty() && word.back() == ',') word.pop_back(); tokens.push_back(word); }
-        processLine(tokens, icFile);
+    bool open(const char *path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) { mapped = p; data = (const char *)p; size = st.st_size; }
+        }
+        ::close(fd);
+        if (!mapped) {
+            ifstream in(path, ios::binary);
+            copy.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+            data = copy.data(); size = copy.size();
+        }
+        return true;
     }
+    ~SourceBuffer() { if (mapped) munmap(mapped, size); }
+};
+
+bool isBlank(char c){ return c==' ' || c=='\t' || c=='\r' || c=='\v' || c=='\f'; }
 
-    if ((int)littab.size() > literalPoolStart) pooltab.push_back(literalPoolStart + 1);
+// Split [p, end) into whitespace-separated tokens with one trailing ',' removed;
+// tokens views the source buffer and is reused across lines
+void tokenize(const char *p, const char *end, vector<string_view> &tokens) {
+    tokens.clear();
+    while (p < end) {
+        while (p < end && isBlank(*p)) ++p;
+        const char *start = p;
+        while (p < end && !isBlank(*p)) ++p;
+        if (p == start) break;
+        size_t len = p - start;
+        if (start[len-1] == ',') --len;
+        tokens.emplace_back(start, len);
+    }
+}
 
+void Assembler::assemble(const char *p, const char *end) {
+    vector<string_view> tokens;
+    while (p < end) {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if (!eol) eol = end;
+        tokenize(p, eol, tokens);
+        processLine(tokens);
+        p = eol + 1;
+    }
+    finish();
+}
+
+void Assembler::writeTables(bool binaryIC) {
+    if (!onePass) {
+        ofstream icFile("intermediate.txt");
+        for (const ICRecord &r : ic) writeICText(icFile, r);
+        if (binaryIC) writeICBinary("intermediate.bin", ic);
+    }
+
+    ofstream symFile("symtab.txt");
     symFile << "Index\tSymbol\tAddress\n";
     for (int i = 0; i < (int)symtab.size(); i++)
         symFile << i + 1 << "\t" << symtab[i].name << "\t" << symtab[i].addr << "\n";
 
+    // symbols EQU'd to a plain number, for pass2 -r to leave out of relocation
+    ofstream absFile("abstab.txt");
+    absFile << "Index\tSymbol\n";
+    for (int i = 0; i < (int)symtab.size(); i++)
+        if (!symtab[i].relocatable) absFile << i + 1 << "\t" << symtab[i].name << "\n";
+
+    ofstream litFile("littab.txt");
     litFile << "Index\tLiteral\tAddress\n";
     for (int i = 0; i < (int)littab.size(); i++)
         litFile << i + 1 << "\t" << littab[i].lit << "\t" << littab[i].addr << "\n";
 
+    ofstream poolFile("pooltab.txt");
     poolFile << "Pool#\tStartIndex\n";
     for (int i = 0; i < (int)pooltab.size(); i++)
         poolFile << i + 1 << "\t" << pooltab[i] << "\n";
+}
 
-    cout << "Pass 1 completed \n";
-    cout << "Generated: intermediate.txt, symtab.txt, littab.txt, pooltab.txt\n";
+// Run job(i) for i in [0, n) on up to `threads` workers
+template <class Job>
+void parallelFor(int n, int threads, Job job) {
+    atomic<int> next(0);
+    vector<thread> pool;
+    for (int t = 0; t < max(1, min(threads, n)); t++)
+        pool.emplace_back([&]() { for (int i; (i = next++) < n; ) job(i); });
+    for (thread &t : pool) t.join();
+}
+
+// Multi-module build: Pass 1 of every module in parallel, then a link step that
+// lays the modules out one after another, relocates each module's own symbols
+// and literals, and resolves symbols a module uses but does not define against
+// the other modules. Pass 2 then runs per module (in parallel) on the linked
+// addresses and the pieces are concatenated into one machinecode.txt.
+int assembleModules(const vector<string> &files, int threads) {
+    int n = (int)files.size();
+    vector<Assembler> mods(n);
+    vector<char> ok(n, 1);
+    parallelFor(n, threads, [&](int i) {
+        SourceBuffer src;
+        if (!src.open(files[i].c_str())) { ok[i] = 0; return; }
+        mods[i].name = files[i];
+        mods[i].assemble(src.data, src.data + src.size);
+    });
+    for (int i = 0; i < n; i++)
+        if (!ok[i]) { cerr << "Error: " << files[i] << " not found!\n"; return 1; }
+
+    // layout: module 0 stays at its START, each next one follows the previous
+    vector<int> offset(n);
+    int base = n ? mods[0].startLC : 0;
+    for (int i = 0; i < n; i++) {
+        offset[i] = base - mods[i].startLC;
+        base += mods[i].endLC - mods[i].startLC;
+    }
+
+    // defined symbol -> linked address; EQUs on another module's symbol go
+    // second, repeatedly until no more resolve, since such a symbol may itself
+    // be an EQU on a third module's symbol
+    unordered_map<string_view, int> globals;
+    vector<vector<int>> linked(n);
+    vector<int> unresolved(n, 0);
+    auto external = [&](int i, const Symbol &s) { return s.extBase != -1 && !mods[i].symtab[s.extBase].defined; };
+    auto define = [&](int i, const Symbol &s, int addr) {
+        if (!globals.emplace(s.name, addr).second)
+            cerr << "Error: " << files[i] << ": Symbol also defined in an earlier module: " << s.name << endl;
+    };
+    for (int i = 0; i < n; i++) {
+        linked[i].assign(mods[i].symtab.size(), -1);
+        for (size_t k = 0; k < mods[i].symtab.size(); k++) {
+            const Symbol &s = mods[i].symtab[k];
+            if (!s.defined || external(i, s)) continue;
+            linked[i][k] = s.relocatable ? s.addr + offset[i] : s.addr;
+            define(i, s, linked[i][k]);
+        }
+    }
+    vector<pair<int, int>> pending;
+    for (int i = 0; i < n; i++)
+        for (size_t k = 0; k < mods[i].symtab.size(); k++)
+            if (mods[i].symtab[k].defined && external(i, mods[i].symtab[k])) pending.push_back({i, (int)k});
+    for (size_t before = 0; before != pending.size(); ) {
+        before = pending.size();
+        vector<pair<int, int>> left;
+        for (auto [i, k] : pending) {
+            const Symbol &s = mods[i].symtab[k];
+            auto g = globals.find(mods[i].symtab[s.extBase].name);
+            if (g == globals.end()) { left.push_back({i, k}); continue; }
+            linked[i][k] = g->second + s.extOff;
+            define(i, s, linked[i][k]);
+        }
+        pending.swap(left);
+    }
+    for (auto [i, k] : pending) {
+        unresolved[i]++;
+        cerr << "Error: " << files[i] << ": Cannot resolve " << mods[i].symtab[k].name << " (EQU on an undefined symbol)\n";
+    }
+
+    vector<string> images(n);
+    parallelFor(n, threads, [&](int i) {
+        const Assembler &m = mods[i];
+        vector<Literal> lits;
+        vector<Symbol> syms;
+        for (const Literal &l : m.littab) lits.push_back({l.lit, l.addr == -1 ? -1 : l.addr + offset[i]});
+        for (size_t k = 0; k < m.symtab.size(); k++) {
+            const Symbol &s = m.symtab[k];
+            int addr = linked[i][k];
+            if (!s.defined) {
+                auto g = globals.find(s.name);
+                if (g != globals.end()) addr = g->second; else unresolved[i]++;
+            }
+            syms.push_back({s.name, addr, s.defined});
+        }
+        ostringstream out;
+        generateMachineCode(m.ic, syms, lits, out);
+        images[i] = out.str();
+    });
+
+    ofstream mcFile("machinecode.txt");
+    for (int i = 0; i < n; i++) {
+        mcFile << images[i];
+        cout << files[i] << ": loaded at " << mods[i].startLC + offset[i]
+             << ", " << mods[i].endLC - mods[i].startLC << " words";
+        if (unresolved[i]) cout << ", " << unresolved[i] << " unresolved symbol(s)";
+        cout << "\n";
+    }
+    cout << "Linked " << n << " module(s)\n";
+    cout << "Generated: machinecode.txt\n";
     return 0;
 }
+
+// Blocking FIFO with a fixed capacity: push waits while it is full, pop waits
+// while it is empty and returns false once it is closed and drained
+template <class T>
+struct BoundedQueue {
+    mutex m;
+    condition_variable notFull, notEmpty;
+    deque<T> items;
+    size_t capacity;
+    bool closed = false;
+
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+    void push(T item) {
+        unique_lock<mutex> lock(m);
+        notFull.wait(lock, [&]() { return items.size() < capacity || closed; });
+        if (closed) return;                // consumer gave up: drop the item
+        items.push_back(move(item));
+        notEmpty.notify_one();
+    }
+    bool pop(T &item) {
+        unique_lock<mutex> lock(m);
+        notEmpty.wait(lock, [&]() { return !items.empty() || closed; });
+        if (items.empty()) return false;
+        item = move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+    void close() {
+        lock_guard<mutex> lock(m);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+};
+
+// Macro source (-m): one thread runs the macro processor over the source and
+// hands batches of expanded lines through a bounded queue to Pass 1 on this
+// thread, so no expanded.txt is written. Memory stays at a few batches plus
+// the expansion of one source line (a batch is only handed over between
+// lines, so a single call that expands to a lot is held whole). Returns the
+// number of expanded lines.
+long assembleExpanded(Assembler &as, const char *p, const char *end, int &macroErrors) {
+    const size_t batchBytes = 64 << 10;
+    BoundedQueue<string> queue(16);
+    thread expander([&]() {
+        MacroExpander ex;
+        string raw, batch;
+        while (p < end) {
+            const char *eol = (const char *)memchr(p, '\n', end - p);
+            if (!eol) eol = end;
+            raw.assign(p, eol);
+            ex.expand(raw, batch);
+            if (batch.size() >= batchBytes) { queue.push(move(batch)); batch.clear(); }
+            p = eol + 1;
+        }
+        if (ex.defDepth >= 0) { cerr << "Error: MACRO without MEND\n"; ex.errors++; }
+        if (!batch.empty()) queue.push(move(batch));
+        macroErrors = ex.errors;
+        queue.close();
+    });
+
+    long lines = 0;
+    vector<string_view> tokens;
+    string batch;
+    try {
+        while (queue.pop(batch)) {
+            const char *q = batch.data(), *stop = q + batch.size();
+            while (q < stop) {
+                const char *eol = (const char *)memchr(q, '\n', stop - q);
+                if (!eol) eol = stop;
+                tokenize(q, eol, tokens);
+                as.processLine(tokens);
+                lines++;
+                q = eol + 1;
+            }
+        }
+    } catch (...) {
+        queue.close();                     // unblock the expander so it can be joined
+        expander.join();
+        throw;
+    }
+    expander.join();
+    as.finish();
+    return lines;
+}
+
+// Usage: pass1 [-b] [-f] [-1] [-n] [-o] [-s] [-m]
+//        pass1 -j N module1.asm module2.asm ...
+//   -b  also write intermediate.bin
+//   -f  fused: run Pass 2 on the in-memory tables and write machinecode.txt
+//   -1  one-pass: write machinecode.txt directly, backpatching forward references
+//   -n  with -f or -1, skip the intermediate/table files
+//   -o  with -f, also write the packed object file machinecode.obj
+//   -r  with -o, include the relocation table
+//   -s  print per-phase statistics (STAT lines, see asm_stats.h)
+//   -m  input.txt holds macro definitions and calls: expand it on a second
+//       thread and assemble the expansion as it streams in
+//   -j  assemble and link the given modules on N threads into machinecode.txt
+//       (no other option applies)
+int main(int argc, char *argv[]) {
+    const char *usage = "Usage: pass1 [-b] [-f] [-1] [-n] [-o] [-r] [-s] [-m] | pass1 -j N module...\n";
+    bool binaryIC = false, fused = false, onePass = false, tables = true, object = false, stats = false;
+    bool macros = false, withReloc = false;
+    int threads = 0;
+    vector<string> modules;
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        if (a == "-b") binaryIC = true;
+        else if (a == "-f") fused = true;
+        else if (a == "-1") onePass = true;
+        else if (a == "-n") tables = false;
+        else if (a == "-o") object = true;
+        else if (a == "-r") withReloc = true;
+        else if (a == "-s") stats = true;
+        else if (a == "-m") macros = true;
+        else if (a == "-j" && i + 1 < argc) threads = max(1, atoi(argv[++i]));
+        else if (a[0] != '-') modules.push_back(a);
+        else { cerr << usage; return 1; }
+    }
+    bool single = binaryIC || fused || onePass || !tables || object || withReloc || stats || macros;
+    if (threads ? modules.empty() || single : !modules.empty()) { cerr << usage; return 1; }
+    if (threads) return assembleModules(modules, threads);
+    // options that only apply to some modes are rejected rather than ignored
+    if ((object && (!fused || onePass)) || (withReloc && !object) || (!tables && !fused && !onePass)) {
+        cerr << usage;
+        return 1;
+    }
+
+    PhaseStats pass1Stats("pass1", stats);
+    SourceBuffer src;
+    if (!src.open("input.txt")) { cerr << "Error: input.txt not found!\n"; return 1; }
+    long lines = count(src.data, src.data + src.size, '\n');
+
+    Assembler as;
+    as.onePass = onePass;
+    int macroErrors = 0;
+    if (macros) lines = assembleExpanded(as, src.data, src.data + src.size, macroErrors);
+    else as.assemble(src.data, src.data + src.size);
+
+    if (tables) as.writeTables(binaryIC);
+    pass1Stats.stop(lines);
+    cout << "Pass 1 completed \n";
+    if (tables && onePass)
+        cout << "Generated: symtab.txt, littab.txt, pooltab.txt, abstab.txt\n";
+    else if (tables)
+        cout << "Generated: intermediate.txt, symtab.txt, littab.txt, pooltab.txt, abstab.txt"
+             << (binaryIC ? ", intermediate.bin" : "") << "\n";
+
+    PhaseStats pass2Stats(onePass ? "output" : "pass2", stats && (onePass || fused));
+    if (onePass) {
+        ofstream mcFile("machinecode.txt");
+        for (const MachineWord &w : as.code)
+            for (int i = 0; i < w.repeat; i++) writeMachineWord(mcFile, w.opcode, w.reg, w.mem);
+        cout << "Generated: machinecode.txt\n";
+    }
+    else if (fused) {
+        ofstream mcFile("machinecode.txt");
+        generateMachineCode(as.ic, as.symtab, as.littab, mcFile);
+        if (object) writeObject("machinecode.obj", as.ic, as.symtab, as.littab, withReloc);
+        cout << "Pass 2 completed \n";
+        cout << "Generated: machinecode.txt" << (object ? ", machinecode.obj" : "") << "\n";
+    }
+    pass2Stats.stop(onePass ? (long)as.code.size() : (long)as.ic.size());
+    return macroErrors ? 1 : 0;
+}
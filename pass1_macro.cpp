@@ -5,83 +5,37 @@
 #include <unordered_map>
 #include <string>
 #include <cctype>
+#include "macro_common.h"
 
 using namespace std;
 
 struct MNTEntry {
     string macroName;
     int mdtIndex; // 0-based index into MDT where the macro body starts
+    int formals;  // number of formal parameters, keyword ones included
+    int kpdIndex; // 0-based index into KPDTAB of the first keyword default
+    int keywords; // number of keyword parameters
+};
+
+// keyword parameter default: formal slot, name (no &) and default value
+struct KPDEntry {
+    int slot;
+    string name;
+    string value;
 };
 
 vector<MNTEntry> MNT;
 vector<string> MDT;
 // store ALA list per macro (ordered list of formal parameter names, without &)
 vector<vector<string>> ALA_per_macro;
+vector<KPDEntry> KPDTAB;
 
-string trim(const string &str) {
-    int first = str.find_first_not_of(" \t\r\n");
-    if (first == string::npos) return "";
-    int last = str.find_last_not_of(" \t\r\n");
-    return str.substr(first, (last - first + 1));
-}
-
-vector<string> split(const string &line, char delimiter = ',') {
-    vector<string> tokens;
-    stringstream ss(line);
-    string token;
-    while (getline(ss, token, delimiter)) {
-        tokens.push_back(trim(token));
-    }
-    return tokens;
-}
-
-// Replace occurrences of "&param" in a line with placeholder "#idx"
-string replaceAmpParam(const string &line, const string &param, int idx) {
-    string out;
-    string pattern = "&" + param;
-    string placeholder = "#" + to_string(idx);
-
-    size_t pos = 0;
-    while (pos < line.size()) {
-        size_t found = line.find(pattern, pos);
-        if (found == string::npos) {
-            out.append(line.substr(pos));
-            break;
-        }
-        // append up to found, then placeholder, then continue
-        out.append(line.substr(pos, found - pos));
-        out.append(placeholder);
-        pos = found + pattern.length();
-    }
-    return out;
-}
-
-// parse macro header line: "MACNAME &A, &B"
-// returns pair(macroName, ordered vector of formal parameter names (no &))
-pair<string, vector<string>> parseMacroHeader(const string &headerLine) {
-    stringstream ss(headerLine);
-    string macroName;
-    ss >> macroName;
-    string rest;
-    getline(ss, rest);
-    rest = trim(rest);
-    vector<string> params;
-    if (!rest.empty()) {
-        vector<string> parts = split(rest, ',');
-        for (string p : parts) {
-            p = trim(p);
-            // expect leading '&' — remove it
-            if (!p.empty() && p.front() == '&') p = p.substr(1);
-            if (!p.empty()) params.push_back(p);
-        }
-    }
-    return {macroName, params};
-}
+vector<FormalMatcher> formalMatchers;   // parallel to ALA_per_macro
 
 void writeTables() {
     ofstream mntFile("mnt.txt");
     for (auto &e : MNT) {
-        mntFile << e.macroName << " " << e.mdtIndex << endl;
+        mntFile << e.macroName << " " << e.mdtIndex << " " << e.formals << " " << e.kpdIndex << " " << e.keywords << endl;
     }
     mntFile.close();
 
@@ -91,6 +45,12 @@ void writeTables() {
     }
     mdtFile.close();
 
+    ofstream kpdFile("kpdtab.txt");
+    for (auto &k : KPDTAB) {
+        kpdFile << k.slot << " " << k.name << " " << k.value << endl;
+    }
+    kpdFile.close();
+
     ofstream alaFile("ala.txt");
     // Write ALA per macro in a readable way:
     for (int m = 0; m < (int)MNT.size(); ++m) {
@@ -118,6 +78,7 @@ void pass1(const string &inputFile = "source.asm") {
 
     string line;
     bool inMacroDef = false;
+    int depth = 0;      // MACRO blocks open inside the current definition
 
     while (getline(input, line)) {
         string rawLine = line;
@@ -129,6 +90,13 @@ void pass1(const string &inputFile = "source.asm") {
             continue;
         }
 
+        if (inMacroDef && (tline == "MACRO" || (tline == "MEND" && depth > 0))) {
+            // nested definition: kept in the outer body, defined when the outer macro expands
+            depth += tline == "MACRO" ? 1 : -1;
+            MDT.push_back(tline);
+            continue;
+        }
+
         if (tline == "MACRO") {
             // start macro definition; next line must be header
             if (!getline(input, line)) {
@@ -136,15 +104,18 @@ void pass1(const string &inputFile = "source.asm") {
                 break;
             }
             string header = trim(line);
-            auto parsed = parseMacroHeader(header);
-            string macroName = parsed.first;
-            vector<string> formals = parsed.second;
+            MacroHeader h = parseMacroHeader(header);
 
             // record MNT entry pointing to the index where body will start
             int mdtIndex = (int)MDT.size();
-            MNT.push_back({macroName, mdtIndex});
+            int kpdIndex = (int)KPDTAB.size();
+            for (int i = 0; i < (int)h.formals.size(); ++i) {
+                if (h.keyword[i]) KPDTAB.push_back({i, h.formals[i], h.defaults[i]});
+            }
+            MNT.push_back({h.name, mdtIndex, (int)h.formals.size(), kpdIndex, (int)KPDTAB.size() - kpdIndex});
             // store ALA for this macro
-            ALA_per_macro.push_back(formals);
+            ALA_per_macro.push_back(h.formals);
+            formalMatchers.emplace_back(h.formals);
 
             inMacroDef = true;
             continue; // do not write header into MDT
@@ -159,12 +130,7 @@ void pass1(const string &inputFile = "source.asm") {
 
         if (inMacroDef) {
             // process body line: replace only "&param" with positional placeholders
-            string processed = line;
-            const vector<string> &formals = ALA_per_macro.back();
-            for (int i = 0; i < (int)formals.size(); ++i) {
-                processed = replaceAmpParam(processed, formals[i], i);
-            }
-            MDT.push_back(processed);
+            MDT.push_back(formalMatchers.back().rewrite(line));
         } else {
             // outside macro: copy to intermediate (macro calls remain as-is)
             intermediate << rawLine << endl;
@@ -175,7 +141,7 @@ void pass1(const string &inputFile = "source.asm") {
     intermediate.close();
 
     writeTables();
-    cout << "Pass 1 complete. Files written: mnt.txt, mdt.txt, ala.txt, intermediate.txt" << endl;
+    cout << "Pass 1 complete. Files written: mnt.txt, mdt.txt, kpdtab.txt, ala.txt, intermediate.txt" << endl;
 }
 
 int main() {
@@ -5,9 +5,12 @@
 #include <vector>
 #include <map>
 #include <iomanip> 
+#include "asm_common.h"
+#include "asm_stats.h"
 using namespace std;
 
-struct Symbol { string name; int addr; };
+// relocatable is false for symbols EQU'd to a plain number (listed in abstab.txt)
+struct Symbol { string name; int addr; bool relocatable = true; };
 struct Literal { string lit; int addr; };
 
 vector<Symbol> symtab;
@@ -26,6 +29,19 @@ void loadSymtab() {
     }
 }
 
+// Only needed for the relocation table; without abstab.txt every symbol is
+// taken as relocatable
+void loadAbstab() {
+    ifstream file("abstab.txt");
+    string line;
+    getline(file, line);
+    while (getline(file, line)) {
+        stringstream ss(line);
+        int idx;
+        if (ss >> idx && idx >= 1 && idx <= (int)symtab.size()) symtab[idx - 1].relocatable = false;
+    }
+}
+
 void loadLittab() {
     ifstream file("littab.txt");
     string line;
@@ -39,89 +55,56 @@ void loadLittab() {
     }
 }
 
-int getSymbolAddr(int index) {
-    if (index - 1 < (int)symtab.size())
-        return symtab[index - 1].addr;
-    return -1;
-}
-
-int getLiteralAddr(int index) {
-    if (index - 1 < (int)littab.size())
-        return littab[index - 1].addr;
-    return -1;
-}
-
-void pass2() {
-    ifstream icFile("intermediate.txt");
-    ofstream mcFile("machinecode.txt");
-    if (!icFile) {
-        cerr << "Error: intermediate.txt not found!\n";
-        return;
-    }
-    string line;
-    while (getline(icFile, line)) {
-        stringstream ss(line);
-        string token;
-        vector<string> parts;
-        while (ss >> token) {
-            parts.push_back(token);
+void pass2(bool binaryIC, bool object, bool withReloc, bool stats) {
+    PhaseStats pass2Stats("pass2", stats);
+    vector<ICRecord> ic;
+    if (binaryIC) {
+        if (!readICBinary("intermediate.bin", ic)) {
+            cerr << "Error: intermediate.bin not found!\n";
+            return;
         }
-        if (parts.empty()) continue;
-        string opcodePart;
-        int operandStartIdx;
-        if (parts[0].find('(') != string::npos) {
-            continue;
-        } else {
-            opcodePart = parts[1];
-            operandStartIdx = 2;
+    } else {
+        ifstream icFile("intermediate.txt");
+        if (!icFile) {
+            cerr << "Error: intermediate.txt not found!\n";
+            return;
         }
-        if (opcodePart.find("(IS") != string::npos) {
-            int opcode = stoi(opcodePart.substr(4, 2));
-            string regField = "0";
-            string memField = "000";
-            for (int i = operandStartIdx; i < (int)parts.size(); i++) {
-                if (parts[i].find("(R") != string::npos) {
-                    regField = parts[i].substr(3, 1);
-                } 
-                else if (parts[i].find("(CC") != string::npos) {
-                    regField = parts[i].substr(4, 1);
-                }
-                else if (parts[i].find("(S") != string::npos) {
-                    int symIndex = stoi(parts[i].substr(3, parts[i].size() - 4));
-                    int addr = getSymbolAddr(symIndex);
-                    memField = to_string(addr);
-                }
-                else if (parts[i].find("(L") != string::npos) {
-                    int litIndex = stoi(parts[i].substr(3, parts[i].size() - 4));
-                    int addr = getLiteralAddr(litIndex);
-                    memField = to_string(addr);
-                }
-            }
-            mcFile << setfill('0') << setw(2) << opcode << " "
-                   << regField << " "
-                   << setfill('0') << setw(3) << memField << "\n";
+        string line;
+        ICRecord r;
+        while (getline(icFile, line)) {
+            if (parseICText(line, r)) ic.push_back(r);
         }
-        else if (opcodePart.find("(DL,01") != string::npos) {
-            int val = stoi(parts[operandStartIdx].substr(3, parts[operandStartIdx].size() - 4));
-            mcFile << "00 0 " << setfill('0') << setw(3) << val << "\n";
-        }
-        else if (opcodePart.find("(DL,02") != string::npos) {
-            int size = stoi(parts[operandStartIdx].substr(3, parts[operandStartIdx].size() - 4));
-            for (int i = 0; i < size; i++) {
-                mcFile << "00 0 000\n";
-            }
-        }
-        else if (opcodePart.find("(AD") != string::npos) {}
     }
+    ofstream mcFile("machinecode.txt");
+    generateMachineCode(ic, symtab, littab, mcFile);
+    if (object) writeObject("machinecode.obj", ic, symtab, littab, withReloc);
     cout << "Pass 2 completed \n";
-    cout << "Generated: machinecode.txt\n";
-    icFile.close();
+    cout << "Generated: machinecode.txt" << (object ? ", machinecode.obj" : "") << "\n";
     mcFile.close();
+    pass2Stats.stop((long)ic.size());
 }
 
-int main() {
+// Usage: pass2 [-b] [-o] [-r] [-s]
+//   -b  read intermediate.bin instead of intermediate.txt
+//   -o  also write the packed object file machinecode.obj
+//   -r  with -o, include the relocation table
+//   -s  print per-phase statistics (STAT lines, see asm_stats.h)
+int main(int argc, char *argv[]) {
+    bool binaryIC = false, object = false, withReloc = false, stats = false;
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        if (a == "-b") binaryIC = true;
+        else if (a == "-o") object = true;
+        else if (a == "-r") withReloc = true;
+        else if (a == "-s") stats = true;
+        else { cerr << "Usage: pass2 [-b] [-o] [-r] [-s]\n"; return 1; }
+    }
+    if (withReloc && !object) { cerr << "Usage: pass2 [-b] [-o] [-r] [-s]\n"; return 1; }
+    PhaseStats loadStats("loaders", stats);
     loadSymtab();
     loadLittab();
-    pass2();
+    if (withReloc) loadAbstab();
+    loadStats.stop((long)(symtab.size() + littab.size()));
+    pass2(binaryIC, object, withReloc, stats);
     return 0;
 }
@@ -5,119 +5,209 @@
 #include <unordered_map>
 #include <string>
 #include <algorithm>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "macro_common.h"
 using namespace std;
 
-string trim(const string &s) {
-    int a = s.find_first_not_of(" \t\r\n");
-    if (a == -1) return "";
-    int b = s.find_last_not_of(" \t\r\n");
-    return s.substr(a, b - a + 1);
+// Expand the lines in [p, end) onto out
+void expandRange(MacroExpander &ex, const char *p, const char *end, string &out) {
+    string raw;
+    while (p < end) {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if (!eol) eol = end;
+        raw.assign(p, eol);
+        ex.expand(raw, out);
+        p = eol + 1;
+    }
 }
 
-void replaceAll(string &line, const string &from, const string &to) {
-    int pos = 0;
-    while ((pos = line.find(from, pos)) != string::npos) {
-        line.replace(pos, from.size(), to);
-        pos += to.size();
+// -j: the file is cut into line-aligned chunks that workers expand, each with
+// its own copy of the tables, while this thread writes finished chunks in
+// order; at most `window` chunks are held at once. Without definitions every
+// line expands independently, so the output equals the serial one. A chunk
+// that meets a MACRO block (in the source or a body) is redone serially from
+// its start to the end of the file, since what follows depends on it.
+// Returns the number of errors.
+int expandParallel(const MacroExpander &base, const char *data, size_t size, int threads, ostream &out) {
+    const size_t chunkBytes = 1 << 20;
+    vector<const char *> cut{data};
+    while (cut.back() < data + size) {
+        const char *q = cut.back() + min(chunkBytes, size_t(data + size - cut.back()));
+        const char *eol = q < data + size ? (const char *)memchr(q, '\n', data + size - q) : nullptr;
+        cut.push_back(eol ? eol + 1 : data + size);
+    }
+    int n = (int)cut.size() - 1, window = 2 * threads;
+
+    struct Chunk { string text, errors; int errorCount = 0; bool defined = false, ready = false; };
+    vector<Chunk> chunks(n);
+    mutex m;
+    condition_variable changed;
+    int written = 0;
+    bool stop = false;
+    atomic<int> next(0);
+    vector<thread> pool;
+    for (int t = 0; t < max(1, min(threads, n)); t++)
+        pool.emplace_back([&]() {
+            MacroExpander ex(base);
+            ostringstream errs;
+            ex.err = &errs;
+            for (int i; (i = next++) < n; ) {
+                {
+                    unique_lock<mutex> lock(m);
+                    changed.wait(lock, [&]() { return stop || i < written + window; });
+                    if (stop) return;
+                }
+                string text;
+                ex.errors = 0;
+                ex.sawDefinition = false;
+                errs.str("");
+                expandRange(ex, cut[i], cut[i + 1], text);
+                lock_guard<mutex> lock(m);
+                chunks[i].text = move(text);
+                chunks[i].errors = errs.str();
+                chunks[i].errorCount = ex.errors;
+                chunks[i].defined = ex.sawDefinition || ex.defDepth >= 0;
+                chunks[i].ready = true;
+                changed.notify_all();
+            }
+        });
+
+    int errors = 0, serialFrom = n;
+    for (int i = 0; i < n; i++) {
+        Chunk c;
+        {
+            unique_lock<mutex> lock(m);
+            changed.wait(lock, [&]() { return chunks[i].ready; });
+            if (chunks[i].defined) { serialFrom = i; stop = true; changed.notify_all(); break; }
+            c = move(chunks[i]);
+            written++;
+            changed.notify_all();
+        }
+        out.write(c.text.data(), c.text.size());
+        cerr << c.errors;
+        errors += c.errorCount;
+    }
+    for (thread &t : pool) t.join();
+
+    if (serialFrom < n) {
+        MacroExpander ex(base);
+        string buf;
+        for (int i = serialFrom; i < n; i++) {
+            buf.clear();
+            expandRange(ex, cut[i], cut[i + 1], buf);
+            out.write(buf.data(), buf.size());
+        }
+        if (ex.defDepth >= 0) { cerr << "Error: MACRO without MEND\n"; ex.errors++; }
+        errors += ex.errors;
     }
+    return errors;
 }
 
-vector<string> splitArgs(const string &s) {
-    string t = trim(s);
-    vector<string> args;
-    if (t.empty()) return args;
-
-    bool hasComma = (t.find(',') != string::npos);
-    string token;
-    stringstream ss(t);
-
-    if (hasComma) {
-        while (getline(ss, token, ',')) {
-            token = trim(token);
-            if (!token.empty()) args.push_back(token);
+// Usage: pass2_macro [-d DEPTH] [-L LIB]... [-j N] | pass2_macro -w LIB
+//   -d  deepest chain of macro calls inside expansions (default 64)
+//   -L  also take macros from precompiled library LIB (repeatable; the tables
+//       from pass1_macro win, then earlier libraries); mnt.txt may be absent
+//   -j  expand on N threads (output identical to the serial run)
+//   -w  compile mnt.txt/mdt.txt/kpdtab.txt into library LIB and stop
+int main(int argc, char *argv[]) {
+    MacroExpander ex;
+    string libOut;
+    int threads = 0;
+    deque<MacroLibrary> libs;
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        if (a == "-d" && i + 1 < argc) ex.maxDepth = max(1, atoi(argv[++i]));
+        else if (a == "-w" && i + 1 < argc) libOut = argv[++i];
+        else if (a == "-j" && i + 1 < argc) threads = max(1, atoi(argv[++i]));
+        else if (a == "-L" && i + 1 < argc) {
+            libs.emplace_back();
+            if (!libs.back().open(argv[++i])) { cerr << "Cannot open macro library " << argv[i] << "\n"; return 1; }
+            ex.libraries.push_back(&libs.back());
         }
-    } else {
-        while (ss >> token) args.push_back(token);
+        else { cerr << "Usage: pass2_macro [-d DEPTH] [-L LIB]... [-j N] | pass2_macro -w LIB\n"; return 1; }
     }
-    return args;
-}
 
-int main() {
     ifstream mntFile("mnt.txt");
-    if (!mntFile) { cerr << "Cannot open mnt.txt\n"; return 1; }
+    if (!mntFile && (libs.empty() || !libOut.empty())) { cerr << "Cannot open mnt.txt\n"; return 1; }
 
-    unordered_map<string, int> MNT;
-    string macroName;
-    int mdtIndex;
-    while (mntFile >> macroName >> mdtIndex) MNT[macroName] = mdtIndex;
+    // "name mdtIndex [formals kpdIndex keywords]"; the short form has no keywords
+    struct MNTEntry { string name; int mdtIndex, formals = -1, kpdIndex = 0, keywords = 0; };
+    vector<MNTEntry> mntEntries;
+    string line;
+    while (getline(mntFile, line)) {
+        stringstream ss(line);
+        MNTEntry e;
+        if (!(ss >> e.name >> e.mdtIndex)) continue;
+        if (!(ss >> e.formals >> e.kpdIndex >> e.keywords)) e.formals = -1, e.keywords = 0;
+        mntEntries.push_back(e);
+    }
     mntFile.close();
 
+    // "slot name default" per keyword parameter; missing with old tables
+    vector<KeywordParam> KPDTAB;
+    ifstream kpdFile("kpdtab.txt");
+    while (getline(kpdFile, line)) {
+        stringstream ss(line);
+        KeywordParam k;
+        if (!(ss >> k.slot >> k.name)) continue;
+        getline(ss, k.value);
+        k.value = trim(k.value);
+        KPDTAB.push_back(k);
+    }
+
     ifstream mdtFile("mdt.txt");
-    if (!mdtFile) { cerr << "Cannot open mdt.txt\n"; return 1; }
+    if (!mdtFile && !mntEntries.empty()) { cerr << "Cannot open mdt.txt\n"; return 1; }
 
     vector<string> MDT;
-    string line;
-    getline(mdtFile, line); // handle stray newline
     while (getline(mdtFile, line)) MDT.push_back(line);
+    if (!MDT.empty() && trim(MDT[0]).empty()) MDT.erase(MDT.begin());   // handle stray newline
     mdtFile.close();
 
+    for (auto &e : mntEntries) {
+        CompiledMacro m = compileMacro(MDT, e.mdtIndex);
+        m.formals = e.formals;
+        for (int k = e.kpdIndex; k < e.kpdIndex + e.keywords && k < (int)KPDTAB.size(); k++) m.keywords.push_back(KPDTAB[k]);
+        ex.define(e.name, m);
+    }
+
+    if (!libOut.empty()) {
+        vector<pair<string, const CompiledMacro *>> ms;
+        for (const string &name : ex.names) ms.push_back({name, ex.macros[ex.MNT[name]].get()});
+        if (!writeMacroLibrary(libOut, ms)) { cerr << "Cannot write " << libOut << "\n"; return 1; }
+        cout << "Macro library: " << ms.size() << " macro(s) → " << libOut << "\n";
+        return 0;
+    }
+
     ifstream inter("intermediate.txt");
     ofstream out("expanded.txt");
     if (!inter || !out) { cerr << "File error\n"; return 1; }
 
-    string raw;
-    while (getline(inter, raw)) {
-        string s = trim(raw);
-        if (s.empty()) { out << "\n"; continue; }
-
-        stringstream ss(s);
-        vector<string> tokens;
-        string tok;
-        while (ss >> tok) tokens.push_back(tok);
-
-        string label = "", macro = "";
-
-        if (!tokens.empty() && tokens[0].back() == ':') {
-            label = tokens[0];
-            if (tokens.size() > 1) macro = tokens[1];
-        } else if (tokens.size() > 1 && MNT.find(tokens[1]) != MNT.end()) {
-            label = tokens[0];
-            macro = tokens[1];
-        } else if (!tokens.empty()) {
-            macro = tokens[0];
-        }
-
-        if (macro.empty() || MNT.find(macro) == MNT.end()) {
-            out << raw << "\n";
-            continue;
-        }
-
-        // Extract arguments
-        int pos = raw.find(macro);
-        string argStr = (pos != -1) ? trim(raw.substr(pos + macro.size())) : "";
-        vector<string> args = splitArgs(argStr);
-
-        int start = MNT[macro];
-        bool firstLine = true;
-        for (int i = start; i < MDT.size(); i++) {
-            string body = MDT[i];
-            if (trim(body) == "MEND") break;
-
-            for (int j = 0; j < args.size(); j++) {
-                string ph = "#" + to_string(j);
-                replaceAll(body, ph, args[j]);
-            }
+    if (threads) {
+        inter.close();
+        int fd = open("intermediate.txt", O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) { cerr << "File error\n"; return 1; }
+        void *data = st.st_size ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        close(fd);
+        if (data == MAP_FAILED) { cerr << "Cannot map intermediate.txt\n"; return 1; }
+        int errors = expandParallel(ex, (const char *)data, st.st_size, threads, out);
+        if (data) munmap(data, st.st_size);
+        cout << "Pass 2 complete → expanded.txt\n";
+        return errors ? 1 : 0;
+    }
 
-            body = trim(body);
-            if (firstLine && !label.empty()) {
-                out << label << " " << body << "\n";
-                firstLine = false;
-            } else {
-                out << body << "\n";
-            }
-        }
+    string raw, buf;
+    while (getline(inter, raw)) {
+        buf.clear();
+        ex.expand(raw, buf);
+        out.write(buf.data(), buf.size());
     }
+    if (ex.defDepth >= 0) { cerr << "Error: MACRO without MEND\n"; ex.errors++; }
 
     cout << "Pass 2 complete → expanded.txt\n";
-    return 0;
+    return ex.errors ? 1 : 0;
 }
@@ -0,0 +1,19 @@
+START 100
+MOVER AREG, ='5'
+MOVEM AREG, A
+LOOP MOVER BREG, B
+ADD BREG, ='1'
+BC LT, LOOP
+LTORG
+A DS 3
+ORIGIN LOOP+2
+MULT CREG, B
+BACK EQU LOOP
+B DC '7'
+SUB AREG, ='1'
+BC ANY, NEXT
+NEXT READ C
+PRINT C
+C DS 2
+STOP
+END
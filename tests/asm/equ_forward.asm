@@ -0,0 +1,7 @@
+START 100
+MOVER AREG, X
+ADD BREG, ='5'
+X EQU 105
+Y DS 3
+MOVEM AREG, Y
+END
@@ -0,0 +1,9 @@
+START 200
+MOVER AREG, Z
+BC ANY, L
+Z EQU L+2
+L ADD BREG, ='3'
+LTORG
+W EQU 7
+MOVEM AREG, W
+END
@@ -0,0 +1,11 @@
+START 200
+MOVER AREG, Z
+X DS 1
+X EQU 5
+ADD AREG, X
+Q DC 4
+PRINT UNDEF
+MOVER BREG, ='9'
+ORIGIN Z+1
+Z DS 2
+END
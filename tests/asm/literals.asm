@@ -0,0 +1,10 @@
+START 100
+MOVER AREG, ='5'
+ADD BREG, ='5'
+LTORG
+SUB CREG, ='2'
+MULT AREG, ='5'
+BC GT, L
+L DS 2
+DIV DREG, ='9'
+END
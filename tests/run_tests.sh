@@ -0,0 +1,149 @@
+#!/bin/bash
+# Golden-output checks. Builds the programs from the repository root with
+# $CXX (default g++) into a scratch directory and compares their output with
+# the files kept here, which come from the original implementations.
+#
+# Usage: tests/run_tests.sh
+#   asm/NAME.asm     source; asm/NAME/ holds the tables and machinecode.txt of
+#                    the original two-pass pass1 + pass2. Every mode must give
+#                    the same machine code (and the same tables where written).
+#   macro/NAME.txt   macro source; macro/NAME.expanded.txt is its expansion.
+#                    The original pass2_macro dropped each macro's first body
+#                    line, so these were checked by hand instead. The -j,
+#                    library and pass1 -m routes must agree with it.
+#   sched/NAME.in    processes for the interactive scheduler; sched/NAME.tables
+#                    holds the original program's FCFS, SJF, Priority and
+#                    Round Robin (q = 2, 3) tables. SMP on one core (every
+#                    balancing mode) and one-level MLFQ (= Round Robin) must
+#                    give the same rows.
+#   lru/NAME.in      frames and reference string for pagereplacement;
+#                    lru/NAME.out has the original program's FIFO, LRU(vec)
+#                    and Optimal counts. The list LRU must match LRU(vec) with
+#                    every page index, and pass the random differential check.
+set -u
+tests=$(cd "$(dirname "$0")" && pwd)
+root=$(dirname "$tests")
+cxx=${CXX:-g++}
+work=$(mktemp -d /tmp/asm_tests.XXXXXX)
+trap 'rm -rf "$work"' EXIT
+failures=0
+
+fail() { echo "FAIL $*"; failures=$((failures + 1)); }
+pass() { echo "ok   $*"; }
+
+build() {   # build NAME SOURCE [LIBS...]
+    local name=$1 src=$2
+    shift 2
+    "$cxx" -std=c++17 -O2 -pthread -o "$work/$name" "$root/$src" "$@" || { echo "build of $src failed"; exit 1; }
+}
+
+# same NAME GOLDEN OUTPUT: fail unless the files match
+same() {
+    if cmp -s "$2" "$3"; then return 0; fi
+    fail "$1: $(basename "$3") differs"
+    diff "$2" "$3" | head -10
+    return 1
+}
+
+# --- Assembler (pass1/pass2) ---
+build pass1 pass1.cpp
+build pass2 pass2.cpp
+# run MODE COMMAND...: in a fresh directory holding only $src as input.txt
+run() {
+    local dir=$work/$1
+    rm -rf "$dir" && mkdir "$dir" && cp "$src" "$dir/input.txt"
+    shift
+    (cd "$dir" && "$@") >/dev/null 2>&1
+}
+tables="intermediate.txt symtab.txt littab.txt pooltab.txt"
+for src in "$tests"/asm/*.asm; do
+    name=asm/$(basename "$src" .asm)
+    golden=${src%.asm}
+    ok=1
+    run two "$work/pass1" && (cd "$work/two" && "$work/pass2" >/dev/null 2>&1)
+    for f in $tables machinecode.txt; do same "$name two-pass" "$golden/$f" "$work/two/$f" || ok=0; done
+    run bin "$work/pass1" -b && (cd "$work/bin" && "$work/pass2" -b >/dev/null 2>&1)
+    same "$name -b" "$golden/machinecode.txt" "$work/bin/machinecode.txt" || ok=0
+    run fused "$work/pass1" -f
+    for f in $tables machinecode.txt; do same "$name -f" "$golden/$f" "$work/fused/$f" || ok=0; done
+    run one "$work/pass1" -1
+    same "$name -1" "$golden/machinecode.txt" "$work/one/machinecode.txt" || ok=0
+    for f in symtab.txt littab.txt; do same "$name -1" "$golden/$f" "$work/one/$f" || ok=0; done
+    # the object file does not depend on which program writes it
+    run obj "$work/pass1" -f -o -r && (cd "$work/two" && "$work/pass2" -o -r >/dev/null 2>&1)
+    same "$name -f -o -r" "$work/two/machinecode.obj" "$work/obj/machinecode.obj" || ok=0
+    [ $ok = 1 ] && pass "$name"
+done
+
+# --- Macro processor (pass1_macro/pass2_macro, pass1 -m) ---
+build pass1_macro pass1_macro.cpp
+build pass2_macro pass2_macro.cpp
+for src in "$tests"/macro/*.txt; do
+    case $src in *.expanded.txt) continue ;; esac
+    name=macro/$(basename "$src" .txt)
+    golden=${src%.txt}.expanded.txt
+    ok=1
+    run serial sh -c "'$work/pass1_macro' && '$work/pass2_macro'"
+    same "$name" "$golden" "$work/serial/expanded.txt" || ok=0
+    run chunks sh -c "'$work/pass1_macro' && '$work/pass2_macro' -j 3"
+    same "$name -j 3" "$golden" "$work/chunks/expanded.txt" || ok=0
+    # the same macros from a compiled library instead of mnt.txt/mdt.txt
+    run lib sh -c "'$work/pass1_macro' && '$work/pass2_macro' -w lib.bin && rm mnt.txt mdt.txt kpdtab.txt &&
+                   '$work/pass2_macro' -L lib.bin"
+    same "$name -L" "$golden" "$work/lib/expanded.txt" || ok=0
+    # pass1 -m assembles the expansion as the expander produces it
+    run streamed "$work/pass1" -m -f -n
+    src=$golden run assembled "$work/pass1" -f -n
+    same "$name pass1 -m" "$work/assembled/machinecode.txt" "$work/streamed/machinecode.txt" || ok=0
+    [ $ok = 1 ] && pass "$name"
+done
+
+# --- Scheduler (SchedulingAlgos) ---
+build sched SchedulingAlgos.cpp
+# table rows of the output
+rows() { awk -F'\t' 'NF == 7 && $1 ~ /^[0-9]+$/'; }
+# rows of $golden's tables from table $1 on (1: FCFS ... 4: RR q = 2), each
+# table in pid order like the SMP and MLFQ ones
+golden_rows() {
+    awk -v from="$1" '/^---/ { close("sort -n"); n++; next } n >= from { print | "sort -n" }' "$golden"
+}
+for input in "$tests"/sched/*.in; do
+    name=sched/$(basename "$input" .in)
+    golden=${input%.in}.tables
+    ok=1
+    { cat "$input"; printf '1\n2\n3\n4\n2\n4\n3\n5\n'; } | "$work/sched" | grep -E '^(--- |[0-9]+[[:blank:]])' > "$work/single"
+    same "$name" "$golden" "$work/single" || ok=0
+    golden_rows 1 > "$work/golden_rows"
+    for bal in 1 2 3; do
+        { cat "$input"; for pol in 1 2 3 "4\n2" "4\n3"; do printf "6\n1\n$bal\n0\n$pol\n"; done; printf '5\n'; } |
+            "$work/sched" | rows > "$work/smp$bal"
+        same "$name SMP 1 core, balancing $bal" "$work/golden_rows" "$work/smp$bal" || ok=0
+    done
+    golden_rows 4 > "$work/golden_rr"
+    { cat "$input"; printf '7\n1 2 0 0\n7\n1 3 0 0\n5\n'; } | "$work/sched" | rows > "$work/mlfq"
+    same "$name MLFQ 1 level" "$work/golden_rr" "$work/mlfq" || ok=0
+    [ $ok = 1 ] && pass "$name"
+done
+
+# --- Page replacement (pagereplacement) ---
+build pagereplacement pagereplacement.cpp
+for input in "$tests"/lru/*.in; do
+    name=lru/$(basename "$input" .in)
+    golden=${input%.in}.out
+    ok=1
+    for index in auto hash flat; do
+        "$work/pagereplacement" -i $index < "$input" > "$work/lru" 2>&1
+        grep -E '^(FIFO|LRU\(vec\)|Optimal)' "$work/lru" > "$work/lru_rest"
+        same "$name -i $index" "$golden" "$work/lru_rest" || ok=0
+        # the list LRU counts the same faults as the original vector LRU
+        sed -n 's/^LRU(vec):/LRU:     /p' "$golden" > "$work/lru_want"
+        grep '^LRU:' "$work/lru" > "$work/lru_got"
+        same "$name -i $index" "$work/lru_want" "$work/lru_got" || ok=0
+    done
+    [ $ok = 1 ] && pass "$name"
+done
+if "$work/pagereplacement" --check 2000 > "$work/lru_check" 2>&1; then pass "lru --check"
+else fail "lru --check"; cat "$work/lru_check"; fi
+
+if [ $failures -ne 0 ]; then echo "$failures failure(s)"; exit 1; fi
+echo "all passed"